@@ -68,15 +68,25 @@
 #define UTIL_WEIGHT .60
 
 /* 
- * Alignment requirement in bytes (either 4 or 8) 
+ * Alignment requirement in bytes: 8 for the 32-bit build, 16 for the
+ * 64-bit build (make mdriver64 passes -DALIGNMENT=16)
  */
+#ifndef ALIGNMENT
 #define ALIGNMENT 8  
+#endif
 
 /* 
- * Maximum heap size in bytes 
+ * Default maximum heap size in bytes (reserved, not allocated, up
+ * front; change it at run time with mem_set_maxheap or mdriver -m)
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Granularity in bytes with which memlib commits reserved heap pages
+ * (a multiple of the page size)
+ */
+#define MEM_COMMIT_CHUNK (1<<16)  /* 64 KB */
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
@@ -14,7 +14,16 @@
 #include <string.h>
 #include <assert.h>
 #include <float.h>
+#include <limits.h>
 #include <time.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -30,38 +39,101 @@
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
+/* Payload touching (-T) reads one byte per TOUCH_STRIDE */
+#define TOUCH_STRIDE  64
+
+/* Hardware events counted by -P, see miss_events */
+#define NUM_MISSES     3
+
+/* Returns true if c separates the words of a text trace */
+#define IS_BLANK(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((uintptr_t)(p)) % ALIGNMENT) == 0)
+
+/* Returns true if a memalign alignment is a power of two */
+#define IS_POW2(a) ((a) > 0 && ((a) & ((a) - 1)) == 0)
 
 /****************************** 
  * The key compound data types 
  *****************************/
 
-/* Records the extent of each block's payload */
+/* Records the extent of each block's payload, as a node of a treap
+   ordered by lo (the recorded payloads never overlap) */
 typedef struct range_t {
     char *lo;              /* low payload address */
     char *hi;              /* high payload address */
-    struct range_t *next;  /* next list element */
+    unsigned int prio;     /* random priority, never below a child's */
+    struct range_t *left;  /* ranges below lo (next free record in the pool) */
+    struct range_t *right; /* ranges above hi */
 } range_t;
 
-/* Characterizes a single trace operation (allocator request) */
+/* Types of trace operations */
+enum {ALLOC, FREE, REALLOC, CALLOC, MEMALIGN, USABLE,
+      BATCH_ALLOC, BATCH_FREE, SIZED_FREE,
+      ARENA_NEW, ARENA_ALLOC, ARENA_RESET, ARENA_DESTROY, NUM_OPTYPES};
+
+/* 
+ * Characterizes a single trace operation (allocator request). This is
+ * also the record of a binary trace file, so the fields have fixed
+ * widths and the 32- and 64-bit drivers read the same files.
+ */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
-    int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
+    int32_t type;                     /* type of request */
+    int32_t index;                    /* index for free() to use later */
+    int32_t size;                     /* byte size of alloc/realloc request */
+    int32_t align;                    /* alignment of a memalign request */
+    int32_t count;                    /* blocks (ids index..) of a batch request */
+    int32_t arena;                    /* arena id of an arena request */
+    int32_t first;                    /* first of the count ids an arena reset frees */
 } traceop_t;
 
+/* 
+ * Header of a binary trace file (written by -b). It is followed by
+ * num_ops traceop_t records and then the num_members ids the arena
+ * resets free, all in the byte order of the machine that wrote it.
+ */
+#define TRACE_MAGIC   0x4d4d5452 /* "MMTR" as a native word */
+#define TRACE_VERSION 1
+
+typedef struct {
+    uint32_t magic;        /* TRACE_MAGIC */
+    uint32_t version;      /* TRACE_VERSION */
+    int32_t sugg_heapsize; /* the fields of the text header... */
+    int32_t num_ids;
+    int32_t num_ops;
+    int32_t weight;
+    int32_t num_requests;  /* ... and what the text reader derives */
+    int32_t num_members;
+} tracehdr_t;
+
 /* Holds the information for one trace file*/
 typedef struct {
     int sugg_heapsize;   /* suggested heap size (unused) */
     int num_ids;         /* number of alloc/realloc ids */
     int num_ops;         /* number of distinct requests */
+    int num_requests;    /* allocator calls they stand for (a batch counts n) */
     int weight;          /* weight for this trace (unused) */
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    size_t *payload_sizes; /* requested sizes, which usable requests don't widen */
+    mm_arena_t **arenas; /* arenas by arena id (below num_ids) */
+    int *members;        /* ids freed by each arena reset, from traceop_t.first */
+    int num_members;     /* number of ids in members */
+    char *map;           /* mapped binary trace that ops and members point
+			    into, or NULL if they were malloc'd */
+    size_t map_size;     /* length of that mapping */
 } trace_t;
 
+/* A text trace being split into words where it lies in memory */
+typedef struct {
+    char *start;         /* start of the text */
+    char *next;          /* first byte not read yet */
+    char *end;           /* end of the text */
+    char *path;          /* trace file, for error messages */
+} tokens_t;
+
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
@@ -70,6 +142,7 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    int touch;       /* write each payload and read it back (-T) */
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -81,17 +154,68 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    size_t peak_heap;  /* largest heap size during the util run */
+    size_t final_heap; /* heap size at the end of the util run */
+    size_t copied;     /* payload bytes realloc copied during the util run */
+    long sbrks;        /* mem_sbrk calls during the util run */
+    double misses[NUM_MISSES]; /* misses per op in one speed run (-P),
+				  or -1 if they could not be counted */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* Summarizes the handle replay of a trace (-H) */
+typedef struct {
+    int valid;          /* did every handle block keep its data? */
+    double util;        /* space utilization of the handle replay */
+    int compactions;    /* number of mm_compact calls */
+    size_t moved;       /* bytes moved by mm_compact */
+    double pause_total; /* seconds spent in mm_compact */
+    double pause_max;   /* longest single mm_compact in seconds */
+} hstats_t;
+
+/* 
+ * Latency histograms are HDR-style log-linear: every power of two of
+ * cycles is split into LAT_SUB buckets, so a bucket is within 1/LAT_SUB
+ * of the values in it at any scale
+ */
+#define LAT_SUB_BITS 4
+#define LAT_SUB      (1 << LAT_SUB_BITS)
+#define LAT_BUCKETS  ((64 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+/* A request timed by the latency replay */
+typedef struct {
+    uint64_t cycles;    /* how long it took */
+    int op;             /* its position in the trace */
+    int type;           /* its type, id (arena id for a whole arena) */
+    int index;          /* and size */
+    int size;
+} slowop_t;
+
+/* Summarizes the latency replay of a trace (-L) */
+typedef struct {
+    int valid;                       /* was the trace replayed? */
+    long count[NUM_OPTYPES];         /* requests of each type */
+    uint64_t max[NUM_OPTYPES];       /* slowest request of each type */
+    uint64_t (*hist)[LAT_BUCKETS];   /* histogram of each type */
+    int num_slow;                    /* requests in slow */
+    slowop_t *slow;                  /* the slowest requests */
+} lstats_t;
+
 /********************
  * Global variables
  *******************/
 int verbose = 0;        /* global flag for verbose output */
+static int check_level = MM_CHECK_OFF; /* heap checks in the correctness pass (-c) */
 static int errors = 0;  /* number of errs found when running student malloc */
+static uint64_t counter_ovhd = 0; /* cycles one read of the cycle counter adds */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
+/* Pool of range records, malloc'd RANGE_CHUNK at a time and never freed */
+#define RANGE_CHUNK 4096
+static range_t *range_pool = NULL;          /* free records, linked by left */
+static unsigned int range_seed = 2463534242U; /* xorshift state for priorities */
+
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
@@ -100,19 +224,68 @@ static char *default_tracefiles[] = {
     DEFAULT_TRACEFILES, NULL
 };
 
+/* Allocator options that can be set with -o name=value */
+static struct {
+    char *name;
+    int option;
+} mm_options[] = {
+    {"trim_threshold", MM_TRIM_THRESHOLD},
+    {"top_pad", MM_TOP_PAD},
+    {"mmap_threshold", MM_MMAP_THRESHOLD},
+    {"grow_policy", MM_GROW_POLICY},
+    {"grow_cap", MM_GROW_CAP},
+    {"check_interval", MM_CHECK_INTERVAL},
+    {NULL, 0}
+};
+
+/* Read misses counted by -P: L1 data cache, last level cache, data TLB */
+static struct {
+    char *name;
+    unsigned long long config;  /* PERF_TYPE_HW_CACHE event */
+    int fd;                     /* its counter, or -1 */
+} miss_events[NUM_MISSES] = {
+    {"L1d", PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1},
+    {"LLC", PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1},
+    {"dTLB", PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1},
+};
+
+/* Names of the request types in the latency tables */
+static char *optype_names[NUM_OPTYPES] = {
+    "malloc", "free", "realloc", "calloc", "memalign", "usable",
+    "batch", "batch free", "sized free",
+    "arena new", "arena alloc", "arena reset", "arena destroy"
+};
+
+/* Placement policies compared by -F; must match FIT_POLICIES in the Makefile */
+static char *fit_policies[] = {
+    "good", "first", "best", "next", "address", NULL
+};
+
 
 /********************* 
  * Function prototypes 
  *********************/
 
-/* these functions manipulate range lists */
+/* these functions manipulate range treaps */
 static int add_range(range_t **ranges, char *lo, int size, 
 		     int tracenum, int opnum);
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
+static range_t *range_alloc(void);
+static void range_split(range_t *t, char *lo, range_t **l, range_t **r);
+static range_t *range_merge(range_t *l, range_t *r);
 
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
+static void read_text_trace(trace_t *trace, char *text, size_t len, char *path);
+static void map_binary_trace(trace_t *trace, char *map, size_t len, char *path);
+static void alloc_blocks(trace_t *trace);
+static int next_word(tokens_t *tok);
+static unsigned next_number(tokens_t *tok);
+static void write_trace(trace_t *trace, char *path);
 static void free_trace(trace_t *trace);
 
 /* Routines for evaluating the correctness and speed of libc malloc */
@@ -121,13 +294,39 @@ static void eval_libc_speed(void *ptr);
 
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 double *util);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void touch_new(trace_t *trace, int index, int size);
+static void touch_old(trace_t *trace, int index);
+static int eval_mm_handles(trace_t *trace, int tracenum, int cadence,
+			   hstats_t *stats);
+static int handle_intact(mm_handle_t handle, int index, int size);
+static void eval_mm_latency(trace_t *trace, lstats_t *stats, int nslow);
+static inline uint64_t read_cycles(void);
+static int lat_bucket(uint64_t cycles);
+static uint64_t lat_bucket_top(int b);
 
 /* Various helper routines */
-static void printresults(int n, stats_t *stats);
+static void printresults(int n, stats_t *stats, int show_heap);
+static void printraw(int n, stats_t *stats);
+static void printhandles(int n, stats_t *stats, hstats_t *hstats);
+static int read_telemetry(mm_stats_t *telemetry);
+static void printtelemetry(int n, char **tracefiles, stats_t *stats,
+			   mm_stats_t *telemetry);
+static void printlatency(int n, char **tracefiles, lstats_t *lstats);
+static int slowop_compare(const void *a, const void *b);
+static uint64_t counter_overhead(void);
+static int open_miss_counters(void);
+static void count_misses(void (*f)(void *), void *argp, double ops, 
+			 double *misses);
+static void printmisses(int n, char **tracefiles, stats_t *stats);
+static void compare_fits(char **tracefiles, int n, char *args);
+static void printfitcell(double util, double ops, double secs);
 static void usage(void);
+static long long parse_size(char *str);
+static void set_option(char *arg);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
 static void app_error(char *msg);
@@ -142,14 +341,33 @@ int main(int argc, char **argv)
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
     trace_t *trace = NULL;     /* stores a single trace file in memory */
+    trace_t **traces = NULL;   /* every trace file, parsed once (-k) */
     range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    hstats_t *handle_stats = NULL; /* handle replay stats for each trace */
+    mm_stats_t *telemetry = NULL;  /* allocator telemetry for each trace */
+    lstats_t *lat_stats = NULL;    /* latency replay stats for each trace */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
 
     int team_check = 0;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int raw = 0;         /* If set, print machine-readable results (-r) */
+    int fits = 0;        /* If set, compare the placement policies (-F) */
+    int show_stats = 0;  /* If set, dump the allocator telemetry (-s) */
+    int have_stats = 0;  /* Set if mm.c was built with telemetry */
+    int fused = 0;       /* If set, one replay checks and measures util (-u) */
+    int keep_traces = 0; /* If set, parse each trace once for all passes (-k) */
+    char *binfile = NULL;/* If set, convert the -f trace into this file (-b) */
+    char args[MAXLINE];  /* -f, -t, -m and -o arguments passed on by -F */
+    long long maxheap;   /* heap cap given with -m */
+    int cadence = -1;    /* If >= 0, replay with handles, compacting every
+			    cadence requests (set by -H) */
+    int nslow = -1;      /* If >= 0, time each request and list the nslow
+			    slowest (set by -L) */
+    int touch = 0;       /* If set, the speed runs touch payloads (-T) */
+    int misses = 0;      /* If set, count cache and TLB misses (-P) */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,7 +376,11 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    args[0] = '\0';
+    while ((c = getopt(argc, argv, "f:t:m:o:H:c:b:L:hvVgalrFsukTP")) != EOF) {
+	if (strchr("ftmo", c) != NULL && 
+	    strlen(args) + strlen(optarg) + 6 < MAXLINE)
+	    sprintf(args + strlen(args), " -%c '%s'", c, optarg);
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -178,12 +400,65 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+	case 'm': /* Maximum heap size, optionally with a K, M or G suffix */
+	    if ((maxheap = parse_size(optarg)) <= 0) {
+		usage();
+		exit(1);
+	    }
+	    mem_set_maxheap(maxheap);
+	    break;
+	case 'o': /* Set an allocator option */
+	    set_option(optarg);
+	    break;
+	case 'c': /* Check the heap while checking for correctness */
+	    check_level = atoi(optarg);
+	    if (check_level < MM_CHECK_OFF || check_level > MM_CHECK_SAMPLED) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'L': /* Time each request and list the <n> slowest */
+	    if ((nslow = atoi(optarg)) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
+	case 'H': /* Replay with handles and compact every <n> requests */
+	    if ((cadence = atoi(optarg)) < 0) {
+		usage();
+		exit(1);
+	    }
+	    break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'r': /* Print one line of raw results per trace */
+            raw = 1;
+            break;
+        case 'F': /* Compare the placement policies of mm.c */
+            fits = 1;
+            break;
+        case 's': /* Dump the allocator telemetry of each trace */
+            show_stats = 1;
+            break;
+        case 'u': /* Measure utilization during the correctness pass */
+            fused = 1;
+            break;
+        case 'k': /* Keep every parsed trace for all passes */
+            keep_traces = 1;
+            break;
+        case 'T': /* Touch the payloads in the speed runs */
+            touch = 1;
+            break;
+        case 'P': /* Count cache and TLB misses of each trace */
+            misses = 1;
+            break;
+	case 'b': /* Write the -f trace as a binary trace file */
+	    binfile = optarg;
+	    break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -225,6 +500,18 @@ int main(int argc, char **argv)
 	    printf("Member 2 :%s:%s\n", team.name2, team.id2);
     }
 
+    /* Convert the one -f trace to the binary format and exit */
+    if (binfile != NULL) {
+	if (tracefiles == NULL) {
+	    usage();
+	    exit(1);
+	}
+	trace = read_trace(tracedir, tracefiles[0]);
+	write_trace(trace, binfile);
+	free_trace(trace);
+	exit(0);
+    }
+
     /* 
      * If no -f command line arg, then use the entire set of tracefiles 
      * defined in default_traces[]
@@ -232,11 +519,29 @@ int main(int argc, char **argv)
     if (tracefiles == NULL) {
         tracefiles = default_tracefiles;
         num_tracefiles = sizeof(default_tracefiles) / sizeof(char *) - 1;
-	printf("Using default tracefiles in %s\n", tracedir);
+	if (!raw)
+	    printf("Using default tracefiles in %s\n", tracedir);
+    }
+
+    /* Build and run one driver per placement policy and exit */
+    if (fits) {
+	compare_fits(tracefiles, num_tracefiles, args);
+	exit(0);
     }
 
     /* Initialize the timing package */
     init_fsecs();
+    speed_params.touch = touch;
+    if (misses && open_miss_counters() == 0)
+	printf("(cache and TLB misses not available: perf_event_open failed)\n");
+
+    /* Parse every trace up front, so the libc and mm passes share it */
+    if (keep_traces) {
+	if ((traces = (trace_t **)malloc(num_tracefiles * sizeof(trace_t *))) == NULL)
+	    unix_error("traces malloc in main failed");
+	for (i=0; i < num_tracefiles; i++)
+	    traces[i] = read_trace(tracedir, tracefiles[i]);
+    }
 
     /*
      * Optionally run and evaluate the libc malloc package 
@@ -252,8 +557,8 @@ int main(int argc, char **argv)
 	
 	/* Evaluate the libc malloc package using the K-best scheme */
 	for (i=0; i < num_tracefiles; i++) {
-	    trace = read_trace(tracedir, tracefiles[i]);
-	    libc_stats[i].ops = trace->num_ops;
+	    trace = keep_traces ? traces[i] : read_trace(tracedir, tracefiles[i]);
+	    libc_stats[i].ops = trace->num_requests;
 	    if (verbose > 1)
 		printf("Checking libc malloc for correctness, ");
 	    libc_stats[i].valid = eval_libc_valid(trace, i);
@@ -263,13 +568,14 @@ int main(int argc, char **argv)
 		    printf("and performance.\n");
 		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
 	    }
-	    free_trace(trace);
+	    if (!keep_traces)
+		free_trace(trace);
 	}
 
 	/* Display the libc results in a compact table */
 	if (verbose) {
 	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printresults(num_tracefiles, libc_stats, 0);
 	}
     }
 
@@ -283,37 +589,112 @@ int main(int argc, char **argv)
     mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
     if (mm_stats == NULL)
 	unix_error("mm_stats calloc in main failed");
+    handle_stats = (hstats_t *)calloc(num_tracefiles, sizeof(hstats_t));
+    if (handle_stats == NULL)
+	unix_error("handle_stats calloc in main failed");
+    telemetry = (mm_stats_t *)calloc(num_tracefiles, sizeof(mm_stats_t));
+    if (telemetry == NULL)
+	unix_error("telemetry calloc in main failed");
+    lat_stats = (lstats_t *)calloc(num_tracefiles, sizeof(lstats_t));
+    if (lat_stats == NULL)
+	unix_error("lat_stats calloc in main failed");
+    if (nslow >= 0)
+	counter_ovhd = counter_overhead();
     
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
+	trace = keep_traces ? traces[i] : read_trace(tracedir, tracefiles[i]);
+	mm_stats[i].ops = trace->num_requests;
 	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	    printf(fused ? "Checking mm_malloc for correctness and efficiency, " :
+		   "Checking mm_malloc for correctness, ");
+	mm_setopt(MM_CHECK_LEVEL, check_level);
+	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges,
+					  fused ? &mm_stats[i].util : NULL);
+	mm_setopt(MM_CHECK_LEVEL, MM_CHECK_OFF);
 	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    if (!fused) {
+		if (verbose > 1)
+		    printf("efficiency, ");
+		mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    }
+	    mm_stats[i].peak_heap = mem_peak_heapsize();
+	    mm_stats[i].final_heap = mem_heapsize() + mem_mapsize();
+	    mm_stats[i].copied = mm_copy_bytes();
+	    mm_stats[i].sbrks = mem_sbrk_count();
+	    have_stats = (read_telemetry(&telemetry[i]) == 0);
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (misses)
+		count_misses(eval_mm_speed, &speed_params, mm_stats[i].ops,
+			     mm_stats[i].misses);
+	    if (nslow >= 0) {
+		if (verbose > 1)
+		    printf("Timing each request.\n");
+		eval_mm_latency(trace, &lat_stats[i], nslow);
+	    }
+	    if (cadence >= 0) {
+		if (verbose > 1)
+		    printf("Replaying with handles.\n");
+		handle_stats[i].valid = eval_mm_handles(trace, i, cadence,
+							&handle_stats[i]);
+	    }
 	}
-	free_trace(trace);
+	if (!keep_traces)
+	    free_trace(trace);
+    }
+
+    /* Leave the summary to the -F driver that asked for raw results */
+    if (raw) {
+	printraw(num_tracefiles, mm_stats);
+	exit(errors != 0);
     }
 
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	printresults(num_tracefiles, mm_stats, 1);
+	printf("\n");
+    }
+
+    /* Display the handle replay results next to the plain ones */
+    if (cadence >= 0) {
+	printf("Results for mm malloc with handles, compacting every %d requests:\n",
+	       cadence);
+	printhandles(num_tracefiles, mm_stats, handle_stats);
+	printf("\n");
+    }
+
+    /* Show how the layout fared in the caches and the TLB */
+    if (misses) {
+	printf("Read misses per op in one speed run%s:\n",
+	       touch ? ", payloads touched" : "");
+	printmisses(num_tracefiles, tracefiles, mm_stats);
 	printf("\n");
     }
 
+    /* Show the tail latencies behind each trace's total time */
+    if (nslow >= 0) {
+	printf("Request latency (counter overhead of %llu cycles taken off):\n\n",
+	       (unsigned long long)counter_ovhd);
+	printlatency(num_tracefiles, tracefiles, lat_stats);
+    }
+
+    /* Dump what the allocator counted during each util run */
+    if (show_stats) {
+	if (have_stats)
+	    printtelemetry(num_tracefiles, tracefiles, mm_stats, telemetry);
+	else
+	    printf("No allocator telemetry: build with -DMM_STATS "
+		   "(make mdriver-stats).\n\n");
+    }
+
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
      */
@@ -367,22 +748,25 @@ int main(int argc, char **argv)
 
 
 /*****************************************************************
- * The following routines manipulate the range list, which keeps 
+ * The following routines manipulate the range treap, which keeps 
  * track of the extent of every allocated block payload. We use the 
- * range list to detect any overlapping allocated blocks.
+ * range treap to detect any overlapping allocated blocks. It is a
+ * binary search tree on lo that is also a max-heap on random
+ * priorities, so every operation takes O(log n) expected time.
  ****************************************************************/
 
 /*
  * add_range - As directed by request opnum in trace tracenum,
  *     we've just called the student's mm_malloc to allocate a block of 
  *     size bytes at addr lo. After checking the block for correctness,
- *     we create a range struct for this block and add it to the range list. 
+ *     we create a range struct for this block and add it to the treap. 
  */
 static int add_range(range_t **ranges, char *lo, int size, 
 		     int tracenum, int opnum)
 {
     char *hi = lo + size - 1;
-    range_t *p;
+    range_t *p, *q;
+    range_t **link;
     char msg[MAXLINE];
 
     assert(size > 0);
@@ -395,36 +779,54 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap, or inside
+       one of the mappings the allocator made through memlib */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+	!mem_is_mapped(lo, hi)) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
         return 0;
     }
 
-    /* The payload must not overlap any other payloads */
-    for (p = *ranges;  p != NULL;  p = p->next) {
-        if ((lo >= p->lo && lo <= p-> hi) ||
-            (hi >= p->lo && hi <= p->hi)) {
-	    sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
-		    lo, hi, p->lo, p->hi);
-	    malloc_error(tracenum, opnum, msg);
-	    return 0;
-        }
+    /* 
+     * The payload must not overlap any other payload. The recorded
+     * payloads are disjoint, so if any of them overlaps, the last one
+     * starting at or below hi does.
+     */
+    for (p = *ranges, q = NULL;  p != NULL; ) {
+	if (p->lo <= hi) {
+	    q = p;
+	    p = p->right;
+	}
+	else
+	    p = p->left;
+    }
+    if (q != NULL && q->hi >= lo) {
+	sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+		lo, hi, q->lo, q->hi);
+	malloc_error(tracenum, opnum, msg);
+	return 0;
     }
 
     /* 
-     * Everything looks OK, so remember the extent of this block 
-     * by creating a range struct and adding it the range list.
+     * Everything looks OK, so remember the extent of this block. The
+     * new node goes where its priority puts it, taking over the ranges
+     * of the subtree it displaces on either side of lo.
      */
-    if ((p = (range_t *)malloc(sizeof(range_t))) == NULL)
-	unix_error("malloc error in add_range");
-    p->next = *ranges;
+    p = range_alloc();
     p->lo = lo;
     p->hi = hi;
-    *ranges = p;
+    range_seed ^= range_seed << 13;
+    range_seed ^= range_seed >> 17;
+    range_seed ^= range_seed << 5;
+    p->prio = range_seed;
+    link = ranges;
+    while (*link != NULL && (*link)->prio > p->prio)
+	link = (lo < (*link)->lo) ? &(*link)->left : &(*link)->right;
+    range_split(*link, lo, &p->left, &p->right);
+    *link = p;
     return 1;
 }
 
@@ -434,17 +836,14 @@ static int add_range(range_t **ranges, char *lo, int size,
 static void remove_range(range_t **ranges, char *lo)
 {
     range_t *p;
-    range_t **prevpp = ranges;
-    int size;
-
-    for (p = *ranges;  p != NULL; p = p->next) {
-        if (p->lo == lo) {
-	    *prevpp = p->next;
-            size = p->hi - p->lo + 1;
-            free(p);
-            break;
-        }
-        prevpp = &(p->next);
+    range_t **link = ranges;
+
+    while (*link != NULL && (*link)->lo != lo)
+	link = (lo < (*link)->lo) ? &(*link)->left : &(*link)->right;
+    if ((p = *link) != NULL) {
+	*link = range_merge(p->left, p->right);
+	p->left = range_pool;
+	range_pool = p;
     }
 }
 
@@ -452,15 +851,93 @@ static void remove_range(range_t **ranges, char *lo)
  * clear_ranges - free all of the range records for a trace 
  */
 static void clear_ranges(range_t **ranges)
+{
+    range_t *p = *ranges;
+    range_t *q;
+
+    /* Rotate left children up until the root has none, then free it */
+    while (p != NULL) {
+	if ((q = p->left) != NULL) {
+	    p->left = q->right;
+	    q->right = p;
+	    p = q;
+	}
+	else {
+	    q = p->right;
+	    p->left = range_pool;
+	    range_pool = p;
+	    p = q;
+	}
+    }
+    *ranges = NULL;
+}
+
+/*
+ * range_alloc - take a record from the pool, refilling it with a
+ *     chunk of RANGE_CHUNK records when it is empty
+ */
+static range_t *range_alloc(void)
 {
     range_t *p;
-    range_t *pnext;
+    int i;
 
-    for (p = *ranges;  p != NULL;  p = pnext) {
-        pnext = p->next;
-        free(p);
+    if (range_pool == NULL) {
+	if ((p = (range_t *)malloc(RANGE_CHUNK * sizeof(range_t))) == NULL)
+	    unix_error("malloc error in range_alloc");
+	for (i = 0; i < RANGE_CHUNK; i++) {
+	    p[i].left = range_pool;
+	    range_pool = &p[i];
+	}
     }
-    *ranges = NULL;
+    p = range_pool;
+    range_pool = p->left;
+    return p;
+}
+
+/*
+ * range_split - split treap t into the ranges below lo (*l) and the
+ *     ranges at or above it (*r)
+ */
+static void range_split(range_t *t, char *lo, range_t **l, range_t **r)
+{
+    while (t != NULL) {
+	if (t->lo < lo) {
+	    *l = t;
+	    l = &t->right;
+	    t = t->right;
+	}
+	else {
+	    *r = t;
+	    r = &t->left;
+	    t = t->left;
+	}
+    }
+    *l = *r = NULL;
+}
+
+/*
+ * range_merge - join treaps l and r, where every range of l lies below
+ *     every range of r, and return the result
+ */
+static range_t *range_merge(range_t *l, range_t *r)
+{
+    range_t *root;
+    range_t **link = &root;
+
+    while (l != NULL && r != NULL) {
+	if (l->prio > r->prio) {
+	    *link = l;
+	    link = &l->right;
+	    l = l->right;
+	}
+	else {
+	    *link = r;
+	    link = &r->left;
+	    r = r->left;
+	}
+    }
+    *link = (l != NULL) ? l : r;
+    return root;
 }
 
 
@@ -470,99 +947,461 @@ static void clear_ranges(range_t **ranges)
 
 /*
  * read_trace - read a trace file and store it in memory
+ *   The file is mapped rather than read. A binary trace (see -b) is used
+ *   in place, with ops and members pointing into the mapping; a text
+ *   trace is split into words where it lies and unmapped afterwards.
  */
 static trace_t *read_trace(char *tracedir, char *filename)
 {
-    FILE *tracefile;
     trace_t *trace;
-    char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
-    unsigned max_index = 0;
-    unsigned op_index;
+    struct stat st;
+    char *map;
+    int fd;
 
     if (verbose > 1)
 	printf("Reading tracefile: %s\n", filename);
 
     /* Allocate the trace record */
     if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
-	unix_error("malloc 1 failed in read_trance");
-	
-    /* Read the trace file header */
+	unix_error("malloc 1 failed in read_trace");
+
+    /* Map the whole trace file */
     strcpy(path, tracedir);
     strcat(path, filename);
-    if ((tracefile = fopen(path, "r")) == NULL) {
+    if ((fd = open(path, O_RDONLY)) < 0) {
 	sprintf(msg, "Could not open %s in read_trace", path);
 	unix_error(msg);
     }
-    fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
-    fscanf(tracefile, "%d", &(trace->num_ids));     
-    fscanf(tracefile, "%d", &(trace->num_ops));     
-    fscanf(tracefile, "%d", &(trace->weight));        /* not used */
+    if (fstat(fd, &st) < 0)
+	unix_error("fstat failed in read_trace");
+    if (st.st_size == 0) {
+	printf("Empty tracefile %s\n", path);
+	exit(1);
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+	unix_error("mmap failed in read_trace");
+    close(fd);
+
+    if (st.st_size >= (off_t)sizeof(tracehdr_t) && 
+	((tracehdr_t *)map)->magic == TRACE_MAGIC)
+	map_binary_trace(trace, map, st.st_size, path);
+    else {
+	read_text_trace(trace, map, st.st_size, path);
+	munmap(map, st.st_size);
+    }
+    return trace;
+}
+
+/*
+ * read_text_trace - parse a text (.rep) trace into malloc'd arrays
+ */
+static void read_text_trace(trace_t *trace, char *text, size_t len, char *path)
+{
+    tokens_t tok;
+    int type;
+    unsigned index, size = 0, align, count = 0, k, arena;
+    unsigned max_index = 0;
+    unsigned op_index;
+    unsigned num_members = 0;
+    int *arena_head, *next_member;
+
+    tok.start = tok.next = text;
+    tok.end = text + len;
+    tok.path = path;
+
+    /* Read the trace file header */
+    trace->sugg_heapsize = next_number(&tok); /* not used */
+    trace->num_ids = next_number(&tok);
+    trace->num_ops = next_number(&tok);
+    trace->weight = next_number(&tok);        /* not used */
+    trace->num_requests = trace->num_ops;
+    trace->map = NULL;
     
-    /* We'll store each request line in the trace in this array */
+    /* We'll store each request line in the trace in this array; 
+       unused fields stay zero, so a binary copy is reproducible */
     if ((trace->ops = 
-	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
+	 (traceop_t *)calloc(trace->num_ops, sizeof(traceop_t))) == NULL)
 	unix_error("malloc 2 failed in read_trace");
 
-    /* We'll keep an array of pointers to the allocated blocks here... */
-    if ((trace->blocks = 
-	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
-	unix_error("malloc 3 failed in read_trace");
+    /* The blocks are needed already, for the sizes of sized frees */
+    alloc_blocks(trace);
 
-    /* ... along with the corresponding byte sizes of each block */
-    if ((trace->block_sizes = 
-	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
-	unix_error("malloc 4 failed in read_trace");
+    /* Each arena reset stores the ids it frees here */
+    if ((trace->members = (int *)malloc(trace->num_ops * sizeof(int))) == NULL)
+	unix_error("malloc 6 failed in read_trace");
+
+    /* While reading, each arena keeps a list of its live ids */
+    if ((arena_head = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(next_member = (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 7 failed in read_trace");
+    for (k = 0; k < (unsigned)trace->num_ids; k++)
+	arena_head[k] = -1;
     
     /* read every request line in the trace file */
     index = 0;
     op_index = 0;
-    while (fscanf(tracefile, "%s", type) != EOF) {
-	switch(type[0]) {
+    while ((type = next_word(&tok)) != EOF) {
+	if (op_index == (unsigned)trace->num_ops) {
+	    printf("More than %d requests in tracefile %s\n", 
+		   trace->num_ops, path);
+	    exit(1);
+	}
+	switch(type) {
 	case 'a':
-	    fscanf(tracefile, "%u %u", &index, &size);
+	    index = next_number(&tok);
+	    size = next_number(&tok);
 	    trace->ops[op_index].type = ALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'r':
-	    fscanf(tracefile, "%u %u", &index, &size);
+	    index = next_number(&tok);
+	    size = next_number(&tok);
 	    trace->ops[op_index].type = REALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
+	case 'c':
+	    index = next_number(&tok);
+	    size = next_number(&tok);
+	    trace->ops[op_index].type = CALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    index = next_number(&tok);
+	    align = next_number(&tok);
+	    size = next_number(&tok);
+	    if (!IS_POW2(align)) {
+		printf("Bad alignment %u in tracefile %s\n", align, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = MEMALIGN;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = align;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'u':
+	    index = next_number(&tok);
+	    trace->ops[op_index].type = USABLE;
+	    trace->ops[op_index].index = index;
+	    break;
+	case 'b':
+	    index = next_number(&tok);
+	    count = next_number(&tok);
+	    size = next_number(&tok);
+	    /* Compare with what is left of the ids: index + count can wrap */
+	    if (count == 0 || index >= (unsigned)trace->num_ids || 
+		count > (unsigned)trace->num_ids - index) {
+		printf("Bad batch (b %u %u %u) in tracefile %s\n", 
+		       index, count, size, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = BATCH_ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    trace->ops[op_index].size = size;
+	    max_index = (index + count - 1 > max_index) ? index + count - 1 : max_index;
+	    trace->num_requests += count - 1;
+	    break;
+	case 'x':
+	    index = next_number(&tok);
+	    count = next_number(&tok);
+	    if (count == 0 || index >= (unsigned)trace->num_ids || 
+		count > (unsigned)trace->num_ids - index) {
+		printf("Bad batch free (x %u %u) in tracefile %s\n", 
+		       index, count, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = BATCH_FREE;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    trace->num_requests += count - 1;
+	    break;
+	case 's':
+	    index = next_number(&tok);
+	    trace->ops[op_index].type = SIZED_FREE;
+	    trace->ops[op_index].index = index;
+	    if (index < (unsigned)trace->num_ids)
+		trace->ops[op_index].size = trace->block_sizes[index];
+	    break;
 	case 'f':
-	    fscanf(tracefile, "%ud", &index);
+	    index = next_number(&tok);
 	    trace->ops[op_index].type = FREE;
 	    trace->ops[op_index].index = index;
 	    break;
+	case 'n':
+	case 'z':
+	case 'd':
+	    arena = next_number(&tok);
+	    if (arena >= (unsigned)trace->num_ids) {
+		printf("Arena id %u out of range in tracefile %s\n", arena, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = (type == 'n') ? ARENA_NEW : 
+		(type == 'z') ? ARENA_RESET : ARENA_DESTROY;
+	    trace->ops[op_index].index = 0;
+	    trace->ops[op_index].arena = arena;
+
+	    /* A reset or destroy frees every id allocated since the last one */
+	    trace->ops[op_index].first = num_members;
+	    for (count = 0; arena_head[arena] != -1; count++) {
+		trace->members[num_members++] = arena_head[arena];
+		arena_head[arena] = next_member[arena_head[arena]];
+	    }
+	    trace->ops[op_index].count = count;
+	    if (count > 0)
+		trace->num_requests += count - 1;
+	    break;
+	case 'g':
+	    index = next_number(&tok);
+	    arena = next_number(&tok);
+	    size = next_number(&tok);
+	    if (arena >= (unsigned)trace->num_ids) {
+		printf("Arena id %u out of range in tracefile %s\n", arena, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = ARENA_ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].arena = arena;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    if (index < (unsigned)trace->num_ids) {
+		next_member[index] = arena_head[arena];
+		arena_head[arena] = index;
+	    }
+	    break;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
-		   type[0], path);
+		   type, path);
+	    exit(1);
+	}
+	if (max_index >= (unsigned)trace->num_ids) {
+	    printf("Request id %u out of range in tracefile %s\n", 
+		   max_index, path);
 	    exit(1);
 	}
+
+	/* Remember the latest size of each id for a later sized free */
+	switch (trace->ops[op_index].type) {
+	case ALLOC: case REALLOC: case CALLOC: case MEMALIGN: case ARENA_ALLOC:
+	    trace->block_sizes[index] = size;
+	    break;
+	case BATCH_ALLOC:
+	    for (k = index; k < index + count; k++)
+		trace->block_sizes[k] = size;
+	    break;
+	default:
+	    break;
+	}
 	op_index++;
 	
     }
-    fclose(tracefile);
+    free(arena_head);
+    free(next_member);
+    trace->num_members = num_members;
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
-    
-    return trace;
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
- *              to, all of which were allocated in read_trace().
+ * map_binary_trace - use a mapped binary trace in place; only the
+ *     per-id arrays are allocated
+ */
+static void map_binary_trace(trace_t *trace, char *map, size_t len, char *path)
+{
+    tracehdr_t *hdr = (tracehdr_t *)map;
+    traceop_t *op;
+    long long last;
+    int i;
+
+    /* The header must describe exactly the records that follow */
+    if (hdr->version != TRACE_VERSION || hdr->num_ids <= 0 || 
+	hdr->num_ops < 0 || hdr->num_members < 0 ||
+	len != sizeof(tracehdr_t) + (size_t)hdr->num_ops * sizeof(traceop_t) +
+	(size_t)hdr->num_members * sizeof(int)) {
+	printf("Bad header in binary tracefile %s\n", path);
+	exit(1);
+    }
+    trace->sugg_heapsize = hdr->sugg_heapsize;
+    trace->num_ids = hdr->num_ids;
+    trace->num_ops = hdr->num_ops;
+    trace->num_requests = hdr->num_requests;
+    trace->weight = hdr->weight;
+    trace->num_members = hdr->num_members;
+    trace->ops = (traceop_t *)(map + sizeof(tracehdr_t));
+    trace->members = (int *)(trace->ops + trace->num_ops);
+    trace->map = map;
+    trace->map_size = len;
+
+    /* 
+     * Every id a request names must exist, every batch must be
+     * nonempty and every alignment a power of two, as the text reader
+     * checks. Unused fields are zero, so
+     * no field may be negative; sums are formed in long long so that
+     * they cannot wrap.
+     */
+    for (i = 0; i < trace->num_ops; i++) {
+	op = &trace->ops[i];
+	last = op->index;
+	if (op->type == BATCH_ALLOC || op->type == BATCH_FREE)
+	    last += (long long)op->count - 1;
+	if (op->type < 0 || op->type >= NUM_OPTYPES || op->index < 0 ||
+	    op->size < 0 || op->align < 0 || op->count < 0 ||
+	    op->arena < 0 || op->first < 0 ||
+	    last >= trace->num_ids || op->arena >= trace->num_ids ||
+	    ((op->type == BATCH_ALLOC || op->type == BATCH_FREE) && 
+	     op->count == 0) ||
+	    (op->type == MEMALIGN && !IS_POW2(op->align)) ||
+	    ((op->type == ARENA_RESET || op->type == ARENA_DESTROY) &&
+	     (long long)op->first + op->count > trace->num_members)) {
+	    printf("Bad request %d in binary tracefile %s\n", i, path);
+	    exit(1);
+	}
+    }
+    for (i = 0; i < trace->num_members; i++) {
+	if (trace->members[i] < 0 || trace->members[i] >= trace->num_ids) {
+	    printf("Bad arena member %d in binary tracefile %s\n", i, path);
+	    exit(1);
+	}
+    }
+
+    alloc_blocks(trace);
+}
+
+/*
+ * alloc_blocks - allocate the per-id arrays the replays fill in
+ */
+static void alloc_blocks(trace_t *trace)
+{
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks = 
+	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
+	unix_error("malloc 3 failed in read_trace");
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes = 
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL ||
+	(trace->payload_sizes = 
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
+	unix_error("malloc 4 failed in read_trace");
+
+    /* Arena requests need the arenas */
+    if ((trace->arenas = 
+	 (mm_arena_t **)calloc(trace->num_ids, sizeof(mm_arena_t *))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
+}
+
+/*
+ * next_word - skip to the next word of a text trace and return its
+ *     first character, or EOF at the end of the text
+ */
+static int next_word(tokens_t *tok)
+{
+    char *p = tok->next;
+    int c;
+
+    while (p < tok->end && IS_BLANK(*p))
+	p++;
+    if (p == tok->end) {
+	tok->next = p;
+	return EOF;
+    }
+    c = (unsigned char)*p;
+    while (p < tok->end && !IS_BLANK(*p))
+	p++;
+    tok->next = p;
+    return c;
+}
+
+/*
+ * next_number - read the next word of a text trace as an unsigned
+ *     decimal number; every field is stored as an int, so larger
+ *     numbers are rejected
+ */
+static unsigned next_number(tokens_t *tok)
+{
+    char *p = tok->next;
+    unsigned n = 0;
+
+    while (p < tok->end && IS_BLANK(*p))
+	p++;
+    if (p == tok->end || *p < '0' || *p > '9') {
+	printf("Expected a number at byte %ld of tracefile %s\n", 
+	       (long)(p - tok->start), tok->path);
+	exit(1);
+    }
+    while (p < tok->end && *p >= '0' && *p <= '9') {
+	if (n > (INT_MAX - (unsigned)(*p - '0')) / 10) {
+	    printf("Number too large at byte %ld of tracefile %s\n", 
+		   (long)(p - tok->start), tok->path);
+	    exit(1);
+	}
+	n = n * 10 + (*p++ - '0');
+    }
+    if (p < tok->end && !IS_BLANK(*p)) {
+	printf("Bad number at byte %ld of tracefile %s\n", 
+	       (long)(p - tok->start), tok->path);
+	exit(1);
+    }
+    tok->next = p;
+    return n;
+}
+
+/*
+ * write_trace - store a trace in the binary format read_trace maps
+ */
+static void write_trace(trace_t *trace, char *path)
+{
+    FILE *binfile;
+    tracehdr_t hdr;
+
+    hdr.magic = TRACE_MAGIC;
+    hdr.version = TRACE_VERSION;
+    hdr.sugg_heapsize = trace->sugg_heapsize;
+    hdr.num_ids = trace->num_ids;
+    hdr.num_ops = trace->num_ops;
+    hdr.weight = trace->weight;
+    hdr.num_requests = trace->num_requests;
+    hdr.num_members = trace->num_members;
+
+    if ((binfile = fopen(path, "wb")) == NULL) {
+	sprintf(msg, "Could not open %s in write_trace", path);
+	unix_error(msg);
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, binfile) != 1 ||
+	fwrite(trace->ops, sizeof(traceop_t), trace->num_ops, binfile) 
+	!= (size_t)trace->num_ops ||
+	fwrite(trace->members, sizeof(int), trace->num_members, binfile) 
+	!= (size_t)trace->num_members ||
+	fclose(binfile) != 0) {
+	sprintf(msg, "Could not write %s in write_trace", path);
+	unix_error(msg);
+    }
+}
+
+/*
+ * free_trace - Free the trace record and the arrays it points to,
+ *              which read_trace() allocated or mapped.
  */
 void free_trace(trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
-    free(trace->blocks);      
+    if (trace->map != NULL)   /* unmap the requests... */
+	munmap(trace->map, trace->map_size);
+    else {
+	free(trace->ops);
+	free(trace->members);
+    }
+    free(trace->blocks);      /* free the per-id arrays... */
     free(trace->block_sizes);
+    free(trace->payload_sizes);
+    free(trace->arenas);
     free(trace);              /* and the trace record itself... */
 }
 
@@ -573,13 +1412,22 @@ void free_trace(trace_t *trace)
 
 /*
  * eval_mm_valid - Check the mm malloc package for correctness
+ *   If util is not NULL, the replay also keeps the high water mark of
+ *   the requested payload bytes and stores the utilization there, which
+ *   saves the separate eval_mm_util pass (-u). The allocator sees the
+ *   same calls either way, so the heap ends up the same.
  */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 double *util) 
 {
-    int i, j;
+    int i, j, k;
     int index;
     int size;
     int oldsize;
+    int count;
+    size_t usable;
+    long total_size = 0;     /* requested bytes of the live blocks */
+    long max_total_size = 0; /* ... and their high water mark */
     char *newp;
     char *oldp;
     char *p;
@@ -602,9 +1450,17 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
-
-	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
+
+	    /* Call the student's malloc, calloc or memalign */
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_malloc(size);
+	    if (p == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -616,6 +1472,25 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     */ 
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
 		return 0;
+
+	    /* A memalign block must honour its alignment... */
+	    if (trace->ops[i].type == MEMALIGN && 
+		((uintptr_t)p % trace->ops[i].align) != 0) {
+		sprintf(msg, "mm_memalign payload (%p) not aligned to %d bytes",
+			p, trace->ops[i].align);
+		malloc_error(tracenum, i, msg);
+		return 0;
+	    }
+
+	    /* ... and a calloc block must come back zeroed */
+	    if (trace->ops[i].type == CALLOC) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc did not zero the block");
+			return 0;
+		    }
+		}
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -627,6 +1502,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remember region */
 	    trace->blocks[index] = p;
 	    trace->block_sizes[index] = size;
+	    trace->payload_sizes[index] = size;
+	    total_size += size;
 	    break;
 
         case REALLOC: /* mm_realloc */
@@ -664,6 +1541,28 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remember region */
 	    trace->blocks[index] = newp;
 	    trace->block_sizes[index] = size;
+	    total_size += size - (long)trace->payload_sizes[index];
+	    trace->payload_sizes[index] = size;
+	    break;
+
+        case USABLE: /* mm_malloc_usable_size */
+
+	    /* The usable size covers at least the requested bytes... */
+	    p = trace->blocks[index];
+	    usable = mm_malloc_usable_size(p);
+	    if (usable < trace->block_sizes[index]) {
+		malloc_error(tracenum, i, "mm_malloc_usable_size is smaller "
+			     "than the request");
+		return 0;
+	    }
+
+	    /* ... and all of it must be ours to write without overlapping
+	       any other payload; realloc must preserve it as well */
+	    remove_range(ranges, p);
+	    if (add_range(ranges, p, usable, tracenum, i) == 0)
+		return 0;
+	    memset(p, index & 0xFF, usable);
+	    trace->block_sizes[index] = usable;
 	    break;
 
         case FREE: /* mm_free */
@@ -672,14 +1571,111 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
 	    mm_free(p);
+	    total_size -= trace->payload_sizes[index];
+	    break;
+
+        case BATCH_ALLOC: /* mm_malloc_batch */
+	    count = trace->ops[i].count;
+	    if (mm_malloc_batch(size, count, (void **)&trace->blocks[index]) 
+		!= (size_t)count) {
+		malloc_error(tracenum, i, "mm_malloc_batch failed.");
+		return 0;
+	    }
+
+	    /* Each block of the batch is checked and filled like a malloc */
+	    for (j = index; j < index + count; j++) {
+		if (add_range(ranges, trace->blocks[j], size, tracenum, i) == 0)
+		    return 0;
+		memset(trace->blocks[j], j & 0xFF, size);
+		trace->block_sizes[j] = size;
+		trace->payload_sizes[j] = size;
+	    }
+	    total_size += (long)size * count;
+	    break;
+
+        case BATCH_FREE: /* mm_free_batch */
+	    count = trace->ops[i].count;
+	    for (j = index; j < index + count; j++) {
+		remove_range(ranges, trace->blocks[j]);
+		total_size -= trace->payload_sizes[j];
+	    }
+	    mm_free_batch((void **)&trace->blocks[index], count);
+	    break;
+
+        case SIZED_FREE: /* mm_free_sized */
+	    p = trace->blocks[index];
+	    remove_range(ranges, p);
+	    mm_free_sized(p, size);
+	    total_size -= trace->payload_sizes[index];
+	    break;
+
+        case ARENA_NEW: /* mm_arena_create */
+	    if ((trace->arenas[trace->ops[i].arena] = mm_arena_create(0)) == NULL) {
+		malloc_error(tracenum, i, "mm_arena_create failed.");
+		return 0;
+	    }
+	    break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc */
+	    p = mm_arena_alloc(trace->arenas[trace->ops[i].arena], size);
+	    if (p == NULL) {
+		malloc_error(tracenum, i, "mm_arena_alloc failed.");
+		return 0;
+	    }
+
+	    /* Arena objects are checked and filled like malloc blocks */
+	    if (add_range(ranges, p, size, tracenum, i) == 0)
+		return 0;
+	    memset(p, index & 0xFF, size);
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    trace->payload_sizes[index] = size;
+	    total_size += size;
+	    break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+        case ARENA_DESTROY: /* mm_arena_destroy */
+
+	    /* Every object of the arena must still hold its data */
+	    count = trace->ops[i].count;
+	    for (j = 0; j < count; j++) {
+		index = trace->members[trace->ops[i].first + j];
+		p = trace->blocks[index];
+		for (k = 0; k < (int)trace->block_sizes[index]; k++) {
+		    if (p[k] != (char)(index & 0xFF)) {
+			malloc_error(tracenum, i, "arena object was overwritten "
+				     "before the reset");
+			return 0;
+		    }
+		}
+		remove_range(ranges, p);
+		total_size -= trace->payload_sizes[index];
+	    }
+	    if (trace->ops[i].type == ARENA_RESET)
+		mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+	    else
+		mm_arena_destroy(trace->arenas[trace->ops[i].arena]);
 	    break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
 
+	/* Update statistics */
+	max_total_size = (total_size > max_total_size) ?
+	    total_size : max_total_size;
+    }
+
+    /* With -c, walk the whole heap once more at the end of the trace */
+    if (check_level != MM_CHECK_OFF && mm_check(MM_CHECK_HEAP) < 0) {
+	malloc_error(tracenum, trace->num_ops - 1, "mm_check found the heap corrupt");
+	return 0;
     }
 
+    /* Trimming may have shrunk the heap, so compare against its peak */
+    if (util != NULL)
+	*util = (double)max_total_size / (double)mem_peak_heapsize();
+
     /* As far as we know, this is a valid malloc package */
     return 1;
 }
@@ -689,15 +1685,15 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   The idea is to remember the high water mark "hwm" of the heap for 
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the 
- *   size of the heap in bytes after running the student's malloc 
- *   package on the trace. Note that our implementation of mem_sbrk() 
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap. 
+ *   peak size of the heap in bytes while running the student's malloc 
+ *   package on the trace, as kept by mem_peak_heapsize(): the sbrk 
+ *   heap plus the blocks mapped with mem_map. The package may shrink 
+ *   the heap again, so the final brk is not the high water mark.
  *   
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 {   
-    int i;
+    int i, j, count;
     int index;
     int size, newsize, oldsize;
     int max_total_size = 0;
@@ -714,10 +1710,18 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_malloc(size);
+	    if (p == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -768,13 +1772,73 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    break;
 
+        case USABLE: /* only the requested bytes count as payload */
+	    break;
+
+        case BATCH_ALLOC: /* mm_malloc_batch */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    count = trace->ops[i].count;
+	    if (mm_malloc_batch(size, count, (void **)&trace->blocks[index]) 
+		!= (size_t)count)
+		app_error("mm_malloc_batch failed in eval_mm_util");
+	    for (j = index; j < index + count; j++)
+		trace->block_sizes[j] = size;
+	    total_size += size * count;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case BATCH_FREE: /* mm_free_batch */
+	    index = trace->ops[i].index;
+	    count = trace->ops[i].count;
+	    for (j = index; j < index + count; j++)
+		total_size -= trace->block_sizes[j];
+	    mm_free_batch((void **)&trace->blocks[index], count);
+	    break;
+
+        case SIZED_FREE: /* mm_free_sized */
+	    index = trace->ops[i].index;
+	    total_size -= trace->block_sizes[index];
+	    mm_free_sized(trace->blocks[index], trace->ops[i].size);
+	    break;
+
+        case ARENA_NEW: /* mm_arena_create */
+	    if ((trace->arenas[trace->ops[i].arena] = mm_arena_create(0)) == NULL)
+		app_error("mm_arena_create failed in eval_mm_util");
+	    break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = mm_arena_alloc(trace->arenas[trace->ops[i].arena], size)) == NULL)
+		app_error("mm_arena_alloc failed in eval_mm_util");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+        case ARENA_DESTROY: /* mm_arena_destroy */
+	    count = trace->ops[i].count;
+	    for (j = 0; j < count; j++)
+		total_size -= trace->block_sizes[trace->members[trace->ops[i].first + j]];
+	    if (trace->ops[i].type == ARENA_RESET)
+		mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+	    else
+		mm_arena_destroy(trace->arenas[trace->ops[i].arena]);
+	    break;
+
 	default:
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    /* Trimming may have shrunk the heap, so compare against its peak */
+    return ((double)max_total_size / (double)mem_peak_heapsize());
 }
 
 
@@ -784,9 +1848,11 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
+    int i, j, index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int touch = ((speed_t *)ptr)->touch;
+    static volatile size_t usable_sum; /* keeps the usable-size calls */
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
@@ -803,6 +1869,84 @@ static void eval_mm_speed(void *ptr)
             if ((p = mm_malloc(size)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
+            if (touch)
+		touch_new(trace, index, size);
+            break;
+
+        case CALLOC: /* mm_calloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_calloc(1, size)) == NULL)
+		app_error("mm_calloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            if (touch)
+		touch_new(trace, index, size);
+            break;
+
+        case MEMALIGN: /* mm_memalign */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+		app_error("mm_memalign error in eval_mm_speed");
+            trace->blocks[index] = p;
+            if (touch)
+		touch_new(trace, index, size);
+            break;
+
+        case USABLE: /* mm_malloc_usable_size */
+            index = trace->ops[i].index;
+            usable_sum += mm_malloc_usable_size(trace->blocks[index]);
+            break;
+
+        case BATCH_ALLOC: /* mm_malloc_batch */
+            index = trace->ops[i].index;
+            if (mm_malloc_batch(trace->ops[i].size, trace->ops[i].count, 
+				(void **)&trace->blocks[index]) 
+		!= (size_t)trace->ops[i].count)
+		app_error("mm_malloc_batch error in eval_mm_speed");
+            for (j = 0; touch && j < trace->ops[i].count; j++)
+		touch_new(trace, index + j, trace->ops[i].size);
+            break;
+
+        case BATCH_FREE: /* mm_free_batch */
+            index = trace->ops[i].index;
+            for (j = 0; touch && j < trace->ops[i].count; j++)
+		touch_old(trace, index + j);
+            mm_free_batch((void **)&trace->blocks[index], trace->ops[i].count);
+            break;
+
+        case SIZED_FREE: /* mm_free_sized */
+            index = trace->ops[i].index;
+            if (touch)
+		touch_old(trace, index);
+            mm_free_sized(trace->blocks[index], trace->ops[i].size);
+            break;
+
+        case ARENA_NEW: /* mm_arena_create */
+            if ((trace->arenas[trace->ops[i].arena] = mm_arena_create(0)) == NULL)
+		app_error("mm_arena_create error in eval_mm_speed");
+            break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_arena_alloc(trace->arenas[trace->ops[i].arena], size)) == NULL)
+		app_error("mm_arena_alloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            if (touch)
+		touch_new(trace, index, size);
+            break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+            for (j = 0; touch && j < trace->ops[i].count; j++)
+		touch_old(trace, trace->members[trace->ops[i].first + j]);
+            mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+            break;
+
+        case ARENA_DESTROY: /* mm_arena_destroy */
+            for (j = 0; touch && j < trace->ops[i].count; j++)
+		touch_old(trace, trace->members[trace->ops[i].first + j]);
+            mm_arena_destroy(trace->arenas[trace->ops[i].arena]);
             break;
 
 	case REALLOC: /* mm_realloc */
@@ -812,11 +1956,15 @@ static void eval_mm_speed(void *ptr)
             if ((newp = mm_realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
+            if (touch)
+		touch_new(trace, index, newsize);
             break;
 
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
+            if (touch)
+		touch_old(trace, index);
             mm_free(block);
             break;
 
@@ -825,6 +1973,398 @@ static void eval_mm_speed(void *ptr)
         }
 }
 
+/*
+ * touch_new - write the whole payload of a new or resized block, as the
+ *     program that asked for it would, and remember its size
+ */
+static void touch_new(trace_t *trace, int index, int size)
+{
+    memset(trace->blocks[index], index & 0xFF, size);
+    trace->block_sizes[index] = size;
+}
+
+/*
+ * touch_old - read a block back before it is freed, a byte from every
+ *     cache line of it
+ */
+static void touch_old(trace_t *trace, int index)
+{
+    static volatile char sink;  /* keeps the reads */
+    char *p = trace->blocks[index];
+    size_t j;
+    char sum = 0;
+
+    for (j = 0; j < trace->block_sizes[index]; j += TOUCH_STRIDE)
+	sum += p[j];
+    sink += sum;
+}
+
+/*
+ * eval_mm_handles - Replay the trace with movable blocks (-H). Malloc,
+ *   calloc and batch requests become mm_halloc, realloc becomes
+ *   mm_hrealloc and frees become mm_hfree; memalign and arena
+ *   requests use the usual interface and stay where they are. Every
+ *   cadence requests the heap is compacted and the pause is timed.
+ *   Handle blocks are filled as in eval_mm_valid and checked when they
+ *   are freed or reallocated, which catches a compactor that loses
+ *   data. Returns 0 if it finds a problem.
+ */
+static int eval_mm_handles(trace_t *trace, int tracenum, int cadence,
+			   hstats_t *stats)
+{
+    int i, j, index, size, oldsize, count;
+    int max_total_size = 0;
+    int total_size = 0;
+    mm_handle_t *handles;
+    struct timespec start, end;
+    double pause;
+    char *p;
+
+    memset(stats, 0, sizeof(*stats));
+    if ((handles = (mm_handle_t *)calloc(trace->num_ids, sizeof(mm_handle_t))) == NULL)
+	unix_error("calloc failed in eval_mm_handles");
+
+    /* initialize the heap and the mm malloc package */
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_handles");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+
+	/* Compact the heap every cadence requests and time the pause */
+	if (cadence > 0 && i > 0 && i % cadence == 0) {
+	    clock_gettime(CLOCK_MONOTONIC, &start);
+	    stats->moved += mm_compact();
+	    clock_gettime(CLOCK_MONOTONIC, &end);
+	    pause = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	    stats->pause_total += pause;
+	    if (pause > stats->pause_max)
+		stats->pause_max = pause;
+	    stats->compactions++;
+	}
+
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_halloc */
+        case CALLOC: /* mm_halloc (the fill overwrites the zeroes anyway) */
+        case BATCH_ALLOC: /* mm_halloc for each id of the batch */
+	    count = (trace->ops[i].type == BATCH_ALLOC) ? trace->ops[i].count : 1;
+	    for (j = index; j < index + count; j++) {
+		if ((handles[j] = mm_halloc(size)) == 0) {
+		    malloc_error(tracenum, i, "mm_halloc failed.");
+		    free(handles);
+		    return 0;
+		}
+		p = mm_hlock(handles[j]);
+		if (!IS_ALIGNED(p)) {
+		    sprintf(msg, "Handle payload address (%p) not aligned to %d bytes", 
+			    p, ALIGNMENT);
+		    malloc_error(tracenum, i, msg);
+		    free(handles);
+		    return 0;
+		}
+		memset(p, j & 0xFF, size);
+		mm_hunlock(handles[j]);
+		trace->block_sizes[j] = size;
+	    }
+	    total_size += size * count;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case MEMALIGN: /* mm_memalign, not movable */
+	    if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+		app_error("mm_memalign failed in eval_mm_handles");
+	    handles[index] = 0;
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+	case REALLOC: /* mm_hrealloc */
+	    oldsize = trace->block_sizes[index];
+	    if (handles[index] == 0) {
+		if ((p = mm_realloc(trace->blocks[index], size)) == NULL)
+		    app_error("mm_realloc failed in eval_mm_handles");
+		trace->blocks[index] = p;
+	    }
+	    else {
+		if (!handle_intact(handles[index], index, oldsize)) {
+		    malloc_error(tracenum, i, "handle block lost its data "
+				 "before the realloc");
+		    free(handles);
+		    return 0;
+		}
+		if (mm_hrealloc(handles[index], size) < 0) {
+		    malloc_error(tracenum, i, "mm_hrealloc failed.");
+		    free(handles);
+		    return 0;
+		}
+		if (!handle_intact(handles[index], index,
+				   (size < oldsize) ? size : oldsize)) {
+		    malloc_error(tracenum, i, "mm_hrealloc did not preserve "
+				 "the data from old block");
+		    free(handles);
+		    return 0;
+		}
+		p = mm_hlock(handles[index]);
+		memset(p, index & 0xFF, size);
+		mm_hunlock(handles[index]);
+	    }
+	    trace->block_sizes[index] = size;
+	    total_size += (size - oldsize);
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case FREE: /* mm_hfree */
+        case SIZED_FREE: /* mm_hfree */
+        case BATCH_FREE: /* mm_hfree for each id of the batch */
+	    count = (trace->ops[i].type == BATCH_FREE) ? trace->ops[i].count : 1;
+	    for (j = index; j < index + count; j++) {
+		total_size -= trace->block_sizes[j];
+		if (handles[j] == 0) {
+		    mm_free(trace->blocks[j]);
+		    continue;
+		}
+		if (!handle_intact(handles[j], j, trace->block_sizes[j])) {
+		    malloc_error(tracenum, i, "handle block lost its data "
+				 "before the free");
+		    free(handles);
+		    return 0;
+		}
+		mm_hfree(handles[j]);
+		handles[j] = 0;
+	    }
+	    break;
+
+        case USABLE: /* only the requested bytes count as payload */
+	    break;
+
+        case ARENA_NEW: /* mm_arena_create */
+	    if ((trace->arenas[trace->ops[i].arena] = mm_arena_create(0)) == NULL)
+		app_error("mm_arena_create failed in eval_mm_handles");
+	    break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc, not movable */
+	    if ((p = mm_arena_alloc(trace->arenas[trace->ops[i].arena], size)) == NULL)
+		app_error("mm_arena_alloc failed in eval_mm_handles");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+        case ARENA_DESTROY: /* mm_arena_destroy */
+	    count = trace->ops[i].count;
+	    for (j = 0; j < count; j++)
+		total_size -= trace->block_sizes[trace->members[trace->ops[i].first + j]];
+	    if (trace->ops[i].type == ARENA_RESET)
+		mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+	    else
+		mm_arena_destroy(trace->arenas[trace->ops[i].arena]);
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_handles");
+        }
+    }
+
+    free(handles);
+    stats->util = (double)max_total_size / (double)mem_peak_heapsize();
+    return 1;
+}
+
+/*
+ * handle_intact - Check that the block of handle still holds the low
+ *   byte of index in each of its size bytes
+ */
+static int handle_intact(mm_handle_t handle, int index, int size)
+{
+    char *p = mm_hlock(handle);
+    int j;
+
+    for (j = 0; j < size; j++)
+	if (p[j] != (char)(index & 0xFF))
+	    break;
+    mm_hunlock(handle);
+    return j == size;
+}
+
+/*
+ * eval_mm_latency - Replay the trace once more, timing each request
+ *   with the cycle counter (-L). Each request type gets a log-linear
+ *   histogram, and the nslow slowest requests are kept in a min-heap
+ *   on their cycle count, so the fastest of them is the one replaced.
+ */
+static void eval_mm_latency(trace_t *trace, lstats_t *stats, int nslow)
+{
+    int i, j, k, index, type;
+    uint64_t start, cycles;
+    traceop_t *op;
+    slowop_t tmp;
+    char *p;
+    static volatile size_t usable_sum; /* keeps the usable-size calls */
+
+    memset(stats, 0, sizeof(*stats));
+    if ((stats->hist = calloc(NUM_OPTYPES, sizeof(*stats->hist))) == NULL ||
+	(nslow > 0 && (stats->slow = malloc(nslow * sizeof(slowop_t))) == NULL))
+	unix_error("malloc failed in eval_mm_latency");
+
+    /* Reset the heap and initialize the mm package */
+    mem_reset_brk();
+    if (mm_init() < 0) 
+	app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	op = &trace->ops[i];
+	index = op->index;
+	p = NULL;
+	start = read_cycles();
+        switch (op->type) {
+        case ALLOC: /* mm_malloc */
+	    p = mm_malloc(op->size);
+	    break;
+        case CALLOC: /* mm_calloc */
+	    p = mm_calloc(1, op->size);
+	    break;
+        case MEMALIGN: /* mm_memalign */
+	    p = mm_memalign(op->align, op->size);
+	    break;
+	case REALLOC: /* mm_realloc */
+	    p = mm_realloc(trace->blocks[index], op->size);
+	    break;
+        case USABLE: /* mm_malloc_usable_size */
+	    usable_sum += mm_malloc_usable_size(trace->blocks[index]);
+	    break;
+        case FREE: /* mm_free */
+	    mm_free(trace->blocks[index]);
+	    break;
+        case BATCH_ALLOC: /* mm_malloc_batch */
+	    if (mm_malloc_batch(op->size, op->count, (void **)&trace->blocks[index])
+		!= (size_t)op->count)
+		app_error("mm_malloc_batch error in eval_mm_latency");
+	    break;
+        case BATCH_FREE: /* mm_free_batch */
+	    mm_free_batch((void **)&trace->blocks[index], op->count);
+	    break;
+        case SIZED_FREE: /* mm_free_sized */
+	    mm_free_sized(trace->blocks[index], op->size);
+	    break;
+        case ARENA_NEW: /* mm_arena_create */
+	    if ((trace->arenas[op->arena] = mm_arena_create(0)) == NULL)
+		app_error("mm_arena_create error in eval_mm_latency");
+	    break;
+        case ARENA_ALLOC: /* mm_arena_alloc */
+	    p = mm_arena_alloc(trace->arenas[op->arena], op->size);
+	    break;
+        case ARENA_RESET: /* mm_arena_reset */
+	    mm_arena_reset(trace->arenas[op->arena]);
+	    break;
+        case ARENA_DESTROY: /* mm_arena_destroy */
+	    mm_arena_destroy(trace->arenas[op->arena]);
+	    break;
+	default:
+	    app_error("Nonexistent request type in eval_mm_latency");
+        }
+	cycles = read_cycles() - start;
+
+	/* Requests that return a block must have returned one */
+	type = op->type;
+	if (type == ALLOC || type == CALLOC || type == MEMALIGN || 
+	    type == REALLOC || type == ARENA_ALLOC) {
+	    if (p == NULL)
+		app_error("allocation failed in eval_mm_latency");
+	    trace->blocks[index] = p;
+	}
+
+	/* Take the cost of reading the counter off */
+	cycles = (cycles > counter_ovhd) ? cycles - counter_ovhd : 0;
+	stats->hist[type][lat_bucket(cycles)]++;
+	stats->count[type]++;
+	if (cycles > stats->max[type])
+	    stats->max[type] = cycles;
+
+	/* Keep it if it is among the nslow slowest so far */
+	if (nslow == 0 || 
+	    (stats->num_slow == nslow && cycles <= stats->slow[0].cycles))
+	    continue;
+	tmp.cycles = cycles;
+	tmp.op = i;
+	tmp.type = type;
+	tmp.index = (type == ARENA_NEW || type == ARENA_RESET || 
+		     type == ARENA_DESTROY) ? op->arena : index;
+	tmp.size = op->size;
+	if (stats->num_slow < nslow) {
+	    /* Sift the new request up from the end of the heap */
+	    for (j = stats->num_slow++; j > 0 && 
+		     stats->slow[(j - 1) / 2].cycles > cycles; j = (j - 1) / 2)
+		stats->slow[j] = stats->slow[(j - 1) / 2];
+	}
+	else {
+	    /* Sift it down from the root, replacing the fastest */
+	    for (j = 0; 2 * j + 1 < nslow; j = k) {
+		k = 2 * j + 1;
+		if (k + 1 < nslow && stats->slow[k + 1].cycles < stats->slow[k].cycles)
+		    k++;
+		if (stats->slow[k].cycles >= cycles)
+		    break;
+		stats->slow[j] = stats->slow[k];
+	    }
+	}
+	stats->slow[j] = tmp;
+    }
+    stats->valid = 1;
+}
+
+/*
+ * read_cycles - read the time stamp counter; unlike start_counter and
+ *     get_counter in clock.c this is inlined, so it costs a few cycles
+ */
+static inline uint64_t read_cycles(void)
+{
+    unsigned hi, lo;
+
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * lat_bucket - map a cycle count to its histogram bucket: values below
+ *     LAT_SUB have a bucket each, and each power of two above is split
+ *     into LAT_SUB equal buckets
+ */
+static int lat_bucket(uint64_t cycles)
+{
+    int e;
+
+    if (cycles < LAT_SUB)
+	return (int)cycles;
+    e = 63 - __builtin_clzll(cycles); /* 2^e <= cycles < 2^(e+1) */
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + 
+	(int)((cycles >> (e - LAT_SUB_BITS)) & (LAT_SUB - 1));
+}
+
+/*
+ * lat_bucket_top - the largest cycle count in histogram bucket b
+ */
+static uint64_t lat_bucket_top(int b)
+{
+    int shift;
+
+    if (b < LAT_SUB)
+	return b;
+    shift = (b >> LAT_SUB_BITS) - 1;
+    return ((uint64_t)(LAT_SUB + (b & (LAT_SUB - 1))) << shift) + 
+	((1ULL << shift) - 1);
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -833,7 +2373,7 @@ static void eval_mm_speed(void *ptr)
  */
 static int eval_libc_valid(trace_t *trace, int tracenum)
 {
-    int i, newsize;
+    int i, j, newsize;
     char *p, *newp, *oldp;
 
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -847,6 +2387,65 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 	    trace->blocks[trace->ops[i].index] = p;
 	    break;
 
+        case CALLOC: /* calloc */
+	    if ((p = calloc(1, trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc calloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+        case MEMALIGN: /* memalign */
+	    if ((p = memalign(trace->ops[i].align, trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc memalign failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+        case USABLE: /* malloc_usable_size */
+	    if (malloc_usable_size(trace->blocks[trace->ops[i].index]) == 0) {
+		malloc_error(tracenum, i, "libc malloc_usable_size failed");
+		return 0;
+	    }
+	    break;
+
+        case BATCH_ALLOC: /* libc has no batch malloc: one at a time */
+	    for (j = 0; j < trace->ops[i].count; j++) {
+		if ((p = malloc(trace->ops[i].size)) == NULL) {
+		    malloc_error(tracenum, i, "libc malloc failed");
+		    unix_error("System message");
+		}
+		trace->blocks[trace->ops[i].index + j] = p;
+	    }
+	    break;
+
+        case BATCH_FREE: /* free */
+	    for (j = 0; j < trace->ops[i].count; j++)
+		free(trace->blocks[trace->ops[i].index + j]);
+	    break;
+
+        case SIZED_FREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+        case ARENA_NEW: /* libc has no arenas: nothing to create */
+	    break;
+
+        case ARENA_ALLOC: /* malloc */
+	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc malloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+        case ARENA_RESET: /* free each object of the arena */
+        case ARENA_DESTROY:
+	    for (j = 0; j < trace->ops[i].count; j++)
+		free(trace->blocks[trace->members[trace->ops[i].first + j]]);
+	    break;
+
 	case REALLOC: /* realloc */
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[trace->ops[i].index];
@@ -876,10 +2475,12 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
  */
 static void eval_libc_speed(void *ptr)
 {
-    int i;
+    int i, j;
     int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int touch = ((speed_t *)ptr)->touch;
+    static volatile size_t usable_sum; /* keeps the usable-size calls */
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
@@ -889,6 +2490,8 @@ static void eval_libc_speed(void *ptr)
 	    if ((p = malloc(size)) == NULL)
 		unix_error("malloc failed in eval_libc_speed");
 	    trace->blocks[index] = p;
+	    if (touch)
+		touch_new(trace, index, size);
 	    break;
 
 	case REALLOC: /* realloc */
@@ -899,11 +2502,91 @@ static void eval_libc_speed(void *ptr)
 		unix_error("realloc failed in eval_libc_speed\n");
 	    
 	    trace->blocks[index] = newp;
+	    if (touch)
+		touch_new(trace, index, newsize);
+	    break;
+
+        case CALLOC: /* calloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = calloc(1, size)) == NULL)
+		unix_error("calloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    if (touch)
+		touch_new(trace, index, size);
+	    break;
+
+        case MEMALIGN: /* memalign */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = memalign(trace->ops[i].align, size)) == NULL)
+		unix_error("memalign failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    if (touch)
+		touch_new(trace, index, size);
+	    break;
+
+        case USABLE: /* malloc_usable_size */
+	    index = trace->ops[i].index;
+	    usable_sum += malloc_usable_size(trace->blocks[index]);
+	    break;
+
+        case BATCH_ALLOC: /* malloc, one at a time */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    for (j = 0; j < trace->ops[i].count; j++) {
+		if ((p = malloc(size)) == NULL)
+		    unix_error("malloc failed in eval_libc_speed");
+		trace->blocks[index + j] = p;
+		if (touch)
+		    touch_new(trace, index + j, size);
+	    }
+	    break;
+
+        case BATCH_FREE: /* free, one at a time */
+	    index = trace->ops[i].index;
+	    for (j = 0; j < trace->ops[i].count; j++) {
+		if (touch)
+		    touch_old(trace, index + j);
+		free(trace->blocks[index + j]);
+	    }
+	    break;
+
+        case SIZED_FREE: /* free */
+	    index = trace->ops[i].index;
+	    if (touch)
+		touch_old(trace, index);
+	    free(trace->blocks[index]);
+	    break;
+
+        case ARENA_NEW: /* nothing to create */
+	    break;
+
+        case ARENA_ALLOC: /* malloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = malloc(size)) == NULL)
+		unix_error("malloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    if (touch)
+		touch_new(trace, index, size);
+	    break;
+
+        case ARENA_RESET: /* free, one at a time */
+        case ARENA_DESTROY:
+	    for (j = 0; j < trace->ops[i].count; j++) {
+		index = trace->members[trace->ops[i].first + j];
+		if (touch)
+		    touch_old(trace, index);
+		free(trace->blocks[index]);
+	    }
 	    break;
 	    
         case FREE: /* free */
 	    index = trace->ops[i].index;
 	    block = trace->blocks[index];
+	    if (touch)
+		touch_old(trace, index);
 	    free(block);
 	    break;
 	}
@@ -916,9 +2599,11 @@ static void eval_libc_speed(void *ptr)
 
 
 /*
- * printresults - prints a performance summary for some malloc package
+ * printresults - prints a performance summary for some malloc package;
+ *     show_heap adds the peak and final heap size of each trace, the
+ *     number of bytes realloc copied and the number of sbrk calls
  */
-static void printresults(int n, stats_t *stats) 
+static void printresults(int n, stats_t *stats, int show_heap) 
 {
     int i;
     double secs = 0;
@@ -926,30 +2611,42 @@ static void printresults(int n, stats_t *stats)
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
+    printf("%5s%7s %5s%8s%10s%6s", 
 	   "trace", " valid", "util", "ops", "secs", "Kops");
+    if (show_heap)
+	printf("%9s%9s%9s%7s", "peakKB", "finalKB", "copyKB", "sbrks");
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (show_heap)
+		printf("%9.0f%9.0f%9.0f%7ld", 
+		       stats[i].peak_heap/1024.0,
+		       stats[i].final_heap/1024.0,
+		       stats[i].copied/1024.0,
+		       stats[i].sbrks);
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
 	}
 	else {
-	    printf("%2d%10s%6s%8s%10s%6s\n", 
+	    printf("%2d%10s%6s%8s%10s%6s", 
 		   i,
 		   "no",
 		   "-",
 		   "-",
 		   "-",
 		   "-");
+	    if (show_heap)
+		printf("%9s%9s%9s%7s", "-", "-", "-", "-");
 	}
+	printf("\n");
     }
 
     /* Print the aggregate results for the set of traces */
@@ -972,6 +2669,383 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printraw - prints "raw <trace> <valid> <util> <ops> <secs>" for each
+ *     trace, which is what compare_fits reads back from the variants
+ */
+static void printraw(int n, stats_t *stats)
+{
+    int i;
+
+    for (i=0; i < n; i++)
+	printf("raw %d %d %f %.0f %f\n", 
+	       i, stats[i].valid, stats[i].util, stats[i].ops, stats[i].secs);
+}
+
+/*
+ * printhandles - prints the results of the handle replay (-H) next to
+ *     the util of the plain replay, with the number of compactions, the
+ *     bytes they moved and their average and longest pause
+ */
+static void printhandles(int n, stats_t *stats, hstats_t *hstats)
+{
+    int i;
+    double util = 0;
+    double mm_util = 0;
+
+    printf("%5s%7s %5s%7s%9s%9s%9s%9s\n", 
+	   "trace", " valid", "util", "plain", "compacts", "movedKB",
+	   "avg_us", "max_us");
+    for (i=0; i < n; i++) {
+	if (hstats[i].valid) {
+	    printf("%2d%10s%5.0f%%%6.0f%%%9d%9.0f%9.1f%9.1f\n", 
+		   i,
+		   "yes",
+		   hstats[i].util*100.0,
+		   stats[i].util*100.0,
+		   hstats[i].compactions,
+		   hstats[i].moved/1024.0,
+		   hstats[i].compactions ? 
+		   hstats[i].pause_total*1e6/hstats[i].compactions : 0.0,
+		   hstats[i].pause_max*1e6);
+	    util += hstats[i].util;
+	    mm_util += stats[i].util;
+	}
+	else {
+	    printf("%2d%10s%6s%7s%9s%9s%9s%9s\n", 
+		   i, "no", "-", "-", "-", "-", "-", "-");
+	}
+    }
+    if (errors == 0)
+	printf("%12s%5.0f%%%6.0f%%\n", "Total       ", 
+	       (util/n)*100.0, (mm_util/n)*100.0);
+}
+
+/*
+ * read_telemetry - copies the counters mm.c kept since the last
+ *     mm_init; returns -1 if it was built without them (main can't
+ *     call mm_stats itself, its stats array hides the name)
+ */
+static int read_telemetry(mm_stats_t *telemetry)
+{
+    return mm_stats(telemetry);
+}
+
+/*
+ * printtelemetry - dumps the counters of each util run: calls and
+ *     where they were served, free index searches and how many blocks
+ *     they looked at, splits, the four coalescing cases and the realloc
+ *     paths, then the nonzero buckets of the request size and search
+ *     length histograms ([lo,hi) ranges of powers of two)
+ */
+static void printtelemetry(int n, char **tracefiles, stats_t *stats,
+			   mm_stats_t *telemetry)
+{
+    int i, b;
+    mm_stats_t *t;
+    unsigned long lo;
+
+    for (i=0; i < n; i++) {
+	t = &telemetry[i];
+	printf("Telemetry for trace %d (%s):\n", i, tracefiles[i]);
+	if (!stats[i].valid) {
+	    printf("  (not run: the trace failed)\n\n");
+	    continue;
+	}
+	printf("  calls     %lu malloc, %lu free, %lu realloc\n",
+	       t->mallocs, t->frees, t->reallocs);
+	printf("  served    %lu tcache, %lu slab, %lu mmap\n",
+	       t->tcache_hits, t->slab_allocs, t->mmap_allocs);
+	printf("  searches  %lu (%lu missed), %.2f blocks/search\n",
+	       t->searches, t->search_misses,
+	       t->searches ? (double)t->search_visits / t->searches : 0.0);
+	printf("  placer    %lu split, %lu whole\n",
+	       t->splits, t->whole_fits);
+	printf("  coalescer %lu none, %lu next, %lu prev, %lu both\n",
+	       t->coalesce[0], t->coalesce[1], t->coalesce[2], t->coalesce[3]);
+	printf("  realloc   %lu shrink, %lu grow, %lu slide, %lu copy\n",
+	       t->realloc_shrinks, t->realloc_grows, t->realloc_slides,
+	       t->realloc_copies);
+	printf("  heap      %lu extend, %lu trim\n",
+	       t->heap_extends, t->heap_trims);
+	printf("  %21s%10s%10s\n", "range", "requests", "searches");
+	for (b = 0; b < MM_STATS_BUCKETS; b++) {
+	    if (t->size_hist[b] == 0 && t->search_hist[b] == 0)
+		continue;
+	    lo = b ? 1UL << (b - 1) : 0;
+	    if (b == MM_STATS_BUCKETS - 1)
+		printf("  %10lu-%10s%10lu%10lu\n", lo, "",
+		       t->size_hist[b], t->search_hist[b]);
+	    else
+		printf("  %10lu-%-10lu%10lu%10lu\n", lo, b ? lo << 1 : 1,
+		       t->size_hist[b], t->search_hist[b]);
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printlatency - print the request latency percentiles of each trace
+ *     and its slowest requests (-L)
+ */
+static void printlatency(int n, char **tracefiles, lstats_t *lstats)
+{
+    static double pcts[] = {0.50, 0.90, 0.99, 0.999};
+    int i, t, b, k;
+    long seen;
+    uint64_t top;
+    lstats_t *ls;
+    slowop_t *s;
+
+    for (i=0; i < n; i++) {
+	ls = &lstats[i];
+	printf("Latency in cycles for trace %d (%s):\n", i, tracefiles[i]);
+	if (!ls->valid) {
+	    printf("  (not run: the trace failed)\n\n");
+	    continue;
+	}
+	printf("  %-14s%9s%8s%8s%8s%8s%11s\n",
+	       "request", "count", "p50", "p90", "p99", "p99.9", "max");
+	for (t = 0; t < NUM_OPTYPES; t++) {
+	    if (ls->count[t] == 0)
+		continue;
+	    printf("  %-14s%9ld", optype_names[t], ls->count[t]);
+
+	    /* Each percentile is the top of the bucket that reaches it */
+	    seen = 0;
+	    b = -1;
+	    for (k = 0; k < 4; k++) {
+		while (seen < pcts[k] * ls->count[t])
+		    seen += ls->hist[t][++b];
+		top = lat_bucket_top(b < 0 ? 0 : b);
+		printf("%8llu", (unsigned long long)
+		       (top < ls->max[t] ? top : ls->max[t]));
+	    }
+	    printf("%11llu\n", (unsigned long long)ls->max[t]);
+	}
+
+	/* The heap of slowest requests, slowest first */
+	if (ls->num_slow > 0) {
+	    qsort(ls->slow, ls->num_slow, sizeof(slowop_t), slowop_compare);
+	    printf("  Slowest requests:\n");
+	    for (k = 0; k < ls->num_slow; k++) {
+		s = &ls->slow[k];
+		printf("  %11llu  line %d: %s %s%d", 
+		       (unsigned long long)s->cycles, LINENUM(s->op),
+		       optype_names[s->type], 
+		       (s->type == ARENA_NEW || s->type == ARENA_RESET ||
+			s->type == ARENA_DESTROY) ? "" : "id ", s->index);
+		if (s->size > 0)
+		    printf(", %d bytes", s->size);
+		printf("\n");
+	    }
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * slowop_compare - qsort order for slow requests, slowest first
+ */
+static int slowop_compare(const void *a, const void *b)
+{
+    uint64_t x = ((slowop_t *)a)->cycles, y = ((slowop_t *)b)->cycles;
+
+    return (x < y) - (x > y);
+}
+
+/*
+ * counter_overhead - the fewest cycles between two back to back reads
+ *     of the cycle counter, which eval_mm_latency takes off each request
+ */
+static uint64_t counter_overhead(void)
+{
+    uint64_t start, cycles, least = ~0ULL;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+	start = read_cycles();
+	cycles = read_cycles() - start;
+	if (cycles < least)
+	    least = cycles;
+    }
+    return least;
+}
+
+/*
+ * open_miss_counters - open a counter for each of miss_events in this
+ *     thread; returns the number that perf_event_open allowed
+ */
+static int open_miss_counters(void)
+{
+    struct perf_event_attr attr;
+    int k, opened = 0;
+
+    for (k = 0; k < NUM_MISSES; k++) {
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = miss_events[k].config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	miss_events[k].fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (miss_events[k].fd >= 0)
+	    opened++;
+    }
+    return opened;
+}
+
+/*
+ * count_misses - run f(argp) once with the miss counters on and store
+ *     the misses per op of each, or -1 for those that are not open
+ */
+static void count_misses(void (*f)(void *), void *argp, double ops, 
+			 double *misses)
+{
+    long long count;
+    int k;
+
+    for (k = 0; k < NUM_MISSES; k++) {
+	if (miss_events[k].fd < 0)
+	    continue;
+	ioctl(miss_events[k].fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(miss_events[k].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    f(argp);
+    for (k = 0; k < NUM_MISSES; k++) {
+	misses[k] = -1;
+	if (miss_events[k].fd < 0)
+	    continue;
+	ioctl(miss_events[k].fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(miss_events[k].fd, &count, sizeof(count)) == sizeof(count))
+	    misses[k] = count / ops;
+    }
+}
+
+/*
+ * printmisses - print the misses per op of each trace (-P)
+ */
+static void printmisses(int n, char **tracefiles, stats_t *stats)
+{
+    int i, k;
+
+    printf("%5s%10s", "trace", "ops");
+    for (k = 0; k < NUM_MISSES; k++)
+	printf("%10s", miss_events[k].name);
+    printf("  %s\n", "file");
+    for (i=0; i < n; i++) {
+	printf("%5d", i);
+	if (!stats[i].valid) {
+	    printf("%10s  %s\n", "-", tracefiles[i]);
+	    continue;
+	}
+	printf("%10.0f", stats[i].ops);
+	for (k = 0; k < NUM_MISSES; k++) {
+	    if (stats[i].misses[k] < 0)
+		printf("%10s", "-");
+	    else
+		printf("%10.3f", stats[i].misses[k]);
+	}
+	printf("  %s\n", tracefiles[i]);
+    }
+}
+
+/*
+ * compare_fits - builds mdriver-fit-<policy> for every placement
+ *     policy with "make fit-variants", runs each one with -r and the
+ *     given arguments, and prints a matrix of util% / Kops with one
+ *     row per trace and one column per policy. The driver must be run
+ *     from the directory with the Makefile.
+ */
+static void compare_fits(char **tracefiles, int n, char *args)
+{
+    int nfits = sizeof(fit_policies) / sizeof(char *) - 1;
+    stats_t *stats;
+    char cmd[2*MAXLINE], line[MAXLINE];
+    FILE *fp;
+    int j, t, valid;
+    double util, ops, secs;
+
+    printf("Building the placement policy variants\n");
+    if (system("make -s fit-variants") != 0)
+	app_error("make fit-variants failed");
+
+    /* stats[t*nfits + j] holds trace t under policy j */
+    if ((stats = (stats_t *)calloc(n * nfits, sizeof(stats_t))) == NULL)
+	unix_error("stats calloc in compare_fits failed");
+
+    for (j=0; j < nfits; j++) {
+	sprintf(cmd, "./mdriver-fit-%s -a -r%s", fit_policies[j], args);
+	if ((fp = popen(cmd, "r")) == NULL)
+	    unix_error("popen failed in compare_fits");
+	while (fgets(line, MAXLINE, fp) != NULL) {
+	    if (sscanf(line, "raw %d %d %lf %lf %lf", 
+		       &t, &valid, &util, &ops, &secs) != 5 ||
+		t < 0 || t >= n) {
+		fputs(line, stdout); /* pass error messages through */
+		continue;
+	    }
+	    stats[t*nfits + j].valid = valid;
+	    stats[t*nfits + j].util = util;
+	    stats[t*nfits + j].ops = ops;
+	    stats[t*nfits + j].secs = secs;
+	}
+	pclose(fp);
+    }
+
+    /* One row per trace, one util/Kops cell per policy */
+    printf("\n%-20s", "trace");
+    for (j=0; j < nfits; j++)
+	printf("%13s", fit_policies[j]);
+    printf("\n");
+    for (t=0; t < n; t++) {
+	printf("%-20.20s", tracefiles[t]);
+	for (j=0; j < nfits; j++) {
+	    stats_t *s = &stats[t*nfits + j];
+	    if (s->valid)
+		printfitcell(s->util, s->ops, s->secs);
+	    else
+		printf("%13s", "-");
+	}
+	printf("\n");
+    }
+
+    /* Average util and aggregate throughput as in printresults */
+    printf("%-20s", "Total");
+    for (j=0; j < nfits; j++) {
+	util = ops = secs = 0;
+	valid = 1;
+	for (t=0; t < n; t++) {
+	    valid &= stats[t*nfits + j].valid;
+	    util += stats[t*nfits + j].util;
+	    ops += stats[t*nfits + j].ops;
+	    secs += stats[t*nfits + j].secs;
+	}
+	if (valid)
+	    printfitcell(util/n, ops, secs);
+	else
+	    printf("%13s", "-");
+    }
+    printf("\n(util%% / Kops for each policy)\n");
+    free(stats);
+}
+
+/*
+ * printfitcell - print one util% / Kops cell of the compare_fits
+ *     matrix; a trace too short to be timed has no Kops
+ */
+static void printfitcell(double util, double ops, double secs)
+{
+    char kops[32];
+
+    if (secs > 0)
+	sprintf(kops, "%.0f", (ops/1e3)/secs);
+    else
+	strcpy(kops, "-");
+    printf("%5.0f%%/%7s", util*100.0, kops);
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -999,19 +3073,96 @@ void malloc_error(int tracenum, int opnum, char *msg)
     printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
 }
 
+/*
+ * parse_size - Convert a byte count with an optional K, M or G suffix,
+ *     returning -1 if it is malformed
+ */
+static long long parse_size(char *str)
+{
+    char *end;
+    long long size = strtoll(str, &end, 10);
+
+    switch (*end) {
+    case 'G': case 'g':
+	size <<= 10;
+	/* fall through */
+    case 'M': case 'm':
+	size <<= 10;
+	/* fall through */
+    case 'K': case 'k':
+	size <<= 10;
+	end++;
+	break;
+    }
+    if (*end != '\0' || end == str || size < 0 || size != (long long)(size_t)size)
+	return -1;
+    return size;
+}
+
+/*
+ * set_option - Apply an allocator option given as name=value (-o)
+ */
+static void set_option(char *arg)
+{
+    char *eq = strchr(arg, '=');
+    long long value;
+    int i;
+
+    if (eq == NULL || (value = parse_size(eq + 1)) < 0) {
+	fprintf(stderr, "Bad option %s, expected name=value\n", arg);
+	exit(1);
+    }
+    for (i = 0; mm_options[i].name != NULL; i++) {
+	if (strlen(mm_options[i].name) == (size_t)(eq - arg) &&
+	    strncmp(mm_options[i].name, arg, eq - arg) == 0) {
+	    if (mm_setopt(mm_options[i].option, (size_t)value) < 0) {
+		fprintf(stderr, "mm_setopt rejected %s\n", arg);
+		exit(1);
+	    }
+	    return;
+	}
+    }
+    fprintf(stderr, "Unknown option %s; known options:", arg);
+    for (i = 0; mm_options[i].name != NULL; i++)
+	fprintf(stderr, " %s", mm_options[i].name);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
 /* 
  * usage - Explain the command line arguments
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValrFsukTP] [-f <file>] [-t <dir>] [-m <size>]\n              [-o <name>=<value>] [-H <n>] [-c <level>]\n              [-L <n>] [-b <binfile>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-b <file>  Write the -f trace to <file> in binary form and exit.\n");
+    fprintf(stderr, "\t-c <level> Check the heap during the correctness pass: 1 checks\n");
+    fprintf(stderr, "\t           each block handed to or returned by mm.c, 2 also walks\n");
+    fprintf(stderr, "\t           the heap on every call, 3 every check_interval calls.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-F         Build and compare every placement policy of mm.c.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-k         Parse each trace once and keep it for all passes.\n");
+    fprintf(stderr, "\t-H <n>     Also replay with handles, compacting every <n> requests\n");
+    fprintf(stderr, "\t           (0 = never).\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L <n>     Time each request and print latency percentiles per\n");
+    fprintf(stderr, "\t           request type and the <n> slowest requests.\n");
+    fprintf(stderr, "\t-m <size>  Cap the heap at <size> bytes (K, M or G suffix).\n");
+    fprintf(stderr, "\t-o <n>=<v> Set allocator option <n> (e.g. trim_threshold=128K).\n");
+    fprintf(stderr, "\t           grow_policy is 0 (exact), 1 (shortfall) or 2 (geometric).\n");
+    fprintf(stderr, "\t-P         Count L1d, LLC and dTLB read misses of one speed run.\n");
+    fprintf(stderr, "\t-r         Print one line of raw results per trace.\n");
+    fprintf(stderr, "\t-s         Dump the allocator telemetry of each trace\n");
+    fprintf(stderr, "\t           (needs mm.c built with -DMM_STATS).\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T         Write each payload in the speed runs and read it\n");
+    fprintf(stderr, "\t           back before it is freed.\n");
+    fprintf(stderr, "\t-u         Measure utilization in the correctness pass instead\n");
+    fprintf(stderr, "\t           of a separate replay.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
 }
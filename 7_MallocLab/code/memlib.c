@@ -3,6 +3,7 @@
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
  */
+#define _GNU_SOURCE /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -18,20 +19,41 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_commit_brk; /* end of the committed (read/write) pages */
+static char *mem_zero_brk;   /* heap bytes from here up were never written */
+
+/* mappings made with mem_map, kept outside the sbrk heap */
+#define MEM_MAX_MAPS 1024
+static struct {
+    char *addr;
+    size_t len;
+} mem_maps[MEM_MAX_MAPS];
+static int mem_map_count;      /* number of live mappings */
+static size_t mem_map_bytes;   /* total length of the live mappings */
+static size_t mem_peak_bytes;  /* largest heap plus mapped size since reset */
+static long mem_sbrk_calls;    /* mem_sbrk calls since reset */
+
+static void mem_update_peak(void);
+static size_t mem_max_heap = MAX_HEAP; /* size of the reserved range */
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
+    /* reserve the address range we will use to model the available VM;
+       pages are only made accessible as mem_sbrk reaches them */
+    mem_start_brk = mmap(NULL, mem_max_heap, PROT_NONE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
 	exit(1);
     }
 
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_max_addr = mem_start_brk + mem_max_heap;  /* max legal heap address */
+    mem_brk = mem_start_brk;                      /* heap is empty initially */
+    mem_commit_brk = mem_start_brk;               /* nothing committed yet */
+    mem_zero_brk = mem_start_brk;                 /* all of it is zero */
 }
 
 /* 
@@ -39,7 +61,27 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    munmap(mem_start_brk, mem_max_heap);
+}
+
+/*
+ * mem_set_maxheap - set the size of the heap reserved by the next call
+ *    to mem_init (rounded up to a whole number of pages). The default
+ *    is MAX_HEAP.
+ */
+void mem_set_maxheap(size_t size)
+{
+    size_t pagesize = mem_pagesize();
+
+    mem_max_heap = (size + pagesize - 1) & ~(pagesize - 1);
+}
+
+/*
+ * mem_maxheap - return the largest size the heap may grow to
+ */
+size_t mem_maxheap(void)
+{
+    return mem_max_heap;
 }
 
 /*
@@ -47,27 +89,178 @@ void mem_deinit(void)
  */
 void mem_reset_brk()
 {
+    /* an empty heap has no mappings either */
+    while (mem_map_count > 0) {
+	mem_map_count--;
+	munmap(mem_maps[mem_map_count].addr, mem_maps[mem_map_count].len);
+    }
+    mem_map_bytes = 0;
+
     mem_brk = mem_start_brk;
+    mem_peak_bytes = 0;
+    mem_sbrk_calls = 0;
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. Pages
+ *    are committed in MEM_COMMIT_CHUNK steps as the break moves past
+ *    them. A negative incr shrinks the heap; whole pages above the new
+ *    break are handed back with madvise but stay committed, so growing
+ *    again needs no mprotect.
  */
-void *mem_sbrk(int incr) 
+void *mem_sbrk(intptr_t incr) 
 {
     char *old_brk = mem_brk;
+    size_t commit, pagesize;
+    char *lo, *hi;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    mem_sbrk_calls++;
+    if (incr < 0) {
+	if ((size_t)-incr > (size_t)(mem_brk - mem_start_brk)) {
+	    errno = EINVAL;
+	    fprintf(stderr, "ERROR: mem_sbrk failed. Shrinking below the heap start...\n");
+	    return (void *)-1;
+	}
+	mem_brk += incr;
+
+	/* release the pages that no longer hold any heap byte */
+	pagesize = mem_pagesize();
+	lo = mem_start_brk + (((size_t)(mem_brk - mem_start_brk) + pagesize - 1) & ~(pagesize - 1));
+	hi = mem_start_brk + (((size_t)(old_brk - mem_start_brk) + pagesize - 1) & ~(pagesize - 1));
+	if (lo < hi && madvise(lo, hi - lo, MADV_DONTNEED) == 0 && mem_zero_brk <= hi)
+	    mem_zero_brk = lo; /* the released pages read back as zero */
+	return (void *)old_brk;
+    }
+
+    if ((size_t)incr > (size_t)(mem_max_addr - mem_brk)) {
 	errno = ENOMEM;
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
+
+    /* make the new pages readable and writable */
+    if (mem_brk + incr > mem_commit_brk) {
+	commit = (mem_brk + incr - mem_commit_brk + MEM_COMMIT_CHUNK - 1)
+	    & ~(size_t)(MEM_COMMIT_CHUNK - 1);
+	if (commit > (size_t)(mem_max_addr - mem_commit_brk))
+	    commit = mem_max_addr - mem_commit_brk;
+	if (mprotect(mem_commit_brk, commit, PROT_READ | PROT_WRITE) < 0) {
+	    fprintf(stderr, "ERROR: mem_sbrk failed. mprotect error...\n");
+	    return (void *)-1;
+	}
+	mem_commit_brk += commit;
+    }
+
     mem_brk += incr;
+    if (mem_brk > mem_zero_brk)
+	mem_zero_brk = mem_brk;
+    mem_update_peak();
     return (void *)old_brk;
 }
 
+/*
+ * mem_map - map len bytes (a multiple of the page size) of fresh
+ *    memory outside the sbrk heap, for blocks too big to keep in it.
+ *    Returns NULL on failure.
+ */
+void *mem_map(size_t len)
+{
+    char *addr;
+
+    if (mem_map_count == MEM_MAX_MAPS)
+	return NULL;
+    addr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+	return NULL;
+
+    mem_maps[mem_map_count].addr = addr;
+    mem_maps[mem_map_count].len = len;
+    mem_map_count++;
+    mem_map_bytes += len;
+    mem_update_peak();
+    return addr;
+}
+
+/*
+ * mem_remap - resize a mapping made by mem_map to new_len bytes without
+ *    copying its pages; it may move. Returns NULL on failure, leaving
+ *    the old mapping intact.
+ */
+void *mem_remap(void *addr, size_t new_len)
+{
+    char *new_addr;
+    int i;
+
+    for (i = 0; i < mem_map_count && mem_maps[i].addr != addr; i++)
+	;
+    if (i == mem_map_count)
+	return NULL;
+    new_addr = mremap(addr, mem_maps[i].len, new_len, MREMAP_MAYMOVE);
+    if (new_addr == MAP_FAILED)
+	return NULL;
+
+    mem_map_bytes += new_len - mem_maps[i].len;
+    mem_maps[i].addr = new_addr;
+    mem_maps[i].len = new_len;
+    mem_update_peak();
+    return new_addr;
+}
+
+/*
+ * mem_unmap - release a mapping made by mem_map
+ */
+void mem_unmap(void *addr)
+{
+    int i;
+
+    for (i = 0; i < mem_map_count && mem_maps[i].addr != addr; i++)
+	;
+    if (i == mem_map_count)
+	return;
+    munmap(addr, mem_maps[i].len);
+    mem_map_bytes -= mem_maps[i].len;
+    mem_maps[i] = mem_maps[--mem_map_count];
+}
+
+/*
+ * mem_is_mapped - return 1 if [lo, hi] lies inside one mapping made by
+ *    mem_map, 0 otherwise
+ */
+int mem_is_mapped(void *lo, void *hi)
+{
+    int i;
+
+    for (i = 0; i < mem_map_count; i++)
+	if ((char *)lo >= mem_maps[i].addr &&
+	    (char *)hi < mem_maps[i].addr + mem_maps[i].len)
+	    return 1;
+    return 0;
+}
+
+/*
+ * mem_update_peak - record the largest heap plus mapped size so far
+ */
+static void mem_update_peak(void)
+{
+    size_t bytes = (size_t)(mem_brk - mem_start_brk) + mem_map_bytes;
+
+    if (bytes > mem_peak_bytes)
+	mem_peak_bytes = bytes;
+}
+
+/*
+ * mem_zero_lo - return the lowest heap address from which every byte up
+ *    to the end of the reserved range is still zero: memory the heap has
+ *    never reached, or pages a shrink handed back. Resetting the brk
+ *    does not clear anything, so this is never lowered by mem_reset_brk.
+ */
+void *mem_zero_lo(void)
+{
+    return (void *)mem_zero_brk;
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -92,6 +285,33 @@ size_t mem_heapsize()
     return (size_t)(mem_brk - mem_start_brk);
 }
 
+/*
+ * mem_mapsize() - returns the total size in bytes of the mappings
+ *    made with mem_map
+ */
+size_t mem_mapsize() 
+{
+    return mem_map_bytes;
+}
+
+/*
+ * mem_peak_heapsize() - returns the largest heap size in bytes, counting
+ *    mem_map mappings, since the last mem_reset_brk
+ */
+size_t mem_peak_heapsize() 
+{
+    return mem_peak_bytes;
+}
+
+/*
+ * mem_sbrk_count - returns the number of mem_sbrk calls since the last
+ *     mem_reset_brk
+ */
+long mem_sbrk_count()
+{
+    return mem_sbrk_calls;
+}
+
 /*
  * mem_pagesize() - returns the page size of the system
  */
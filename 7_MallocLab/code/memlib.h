@@ -1,11 +1,22 @@
 #include <unistd.h>
+#include <stdint.h>
 
 void mem_init(void);               
 void mem_deinit(void);
-void *mem_sbrk(int incr);
+void mem_set_maxheap(size_t size);
+size_t mem_maxheap(void);
+void *mem_sbrk(intptr_t incr);
 void mem_reset_brk(void); 
+void *mem_map(size_t len);
+void *mem_remap(void *addr, size_t new_len);
+void mem_unmap(void *addr);
+int mem_is_mapped(void *lo, void *hi);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
+void *mem_zero_lo(void);
 size_t mem_heapsize(void);
+size_t mem_mapsize(void);
+size_t mem_peak_heapsize(void);
+long mem_sbrk_count(void);
 size_t mem_pagesize(void);
 
@@ -1,90 +1,561 @@
 /*
- * mm-naive.c - The fastest, least memory-efficient malloc package.
- * 
- * In this naive approach, a block is allocated by simply incrementing
- * the brk pointer.  A block is pure payload. There are no headers or
- * footers.  Blocks are never coalesced or reused. Realloc is
- * implemented directly using mm_malloc and mm_free.
+ * mm.c - Boundary-tag allocator with a two-level segregated-fit (TLSF)
+ *        free index.
  *
- * NOTE TO STUDENTS: Replace this header comment with your own header
- * comment that gives a high level description of your solution.
+ * Every block carries a 4-byte header holding the block size, the
+ * allocated bit (bit 0) and the allocated bit of the previous block
+ * (bit 1). Only free blocks repeat the size in a footer, which is all
+ * coalescing needs to step backwards; allocated blocks spend just the
+ * header word on overhead. The heap starts with an allocated prologue
+ * block and ends with a zero-sized allocated epilogue header, so
+ * coalescing never has to special-case the heap boundaries. Block
+ * sizes are multiples of ALIGNMENT (8 in the 32-bit build, 16 in the
+ * 64-bit one), which keeps every payload ALIGNMENT-byte aligned.
+ *
+ * Free blocks are additionally linked into one of FL_INDEX_COUNT x
+ * SL_INDEX_COUNT segregated lists. The first level splits sizes by
+ * powers of two, the second level splits each power-of-two range into
+ * SL_INDEX_COUNT equal classes. Two bitmaps record which lists are
+ * non-empty, so a suitable list is located with two find-first-set
+ * operations regardless of heap size. The list links are stored in the
+ * free payload as 32-bit offsets from the heap base, which keeps the
+ * minimum block at 16 bytes but limits the heap to 4 GB.
+ *
+ * Free blocks of LARGE_BLOCK_SIZE bytes or more bypass the segregated
+ * lists and live in a red-black tree keyed by (size, address). The
+ * left/right links reuse the two list words and a third payload word
+ * holds the parent offset with the node colour in its low bit. Large
+ * requests take the smallest block that fits, ties going to the lowest
+ * address, which keeps big blocks from being split needlessly.
+ *
+ * Requests of up to SLAB_MAX_SIZE bytes are served by a slab front end
+ * while at least SLAB_WARMUP such objects are live. Each class
+ * carves SLAB_RUN_SIZE-byte runs out of the boundary-tag heap, aligned
+ * to SLAB_RUN_SIZE relative to the heap base, and hands out slots with
+ * no per-object header; a bitmap in the run header tracks free slots.
+ * A one-bit-per-run page map tells mm_free whether a pointer lives in a
+ * run, and the run header is then found by masking the pointer.
+ *
+ * All of this state lives in an arena. The default build has a single
+ * arena and no locking. Built with -DMM_THREADS, there are ARENA_COUNT
+ * arenas, each behind its own mutex, handed out to threads round-robin.
+ * An arena grows in segments carved from memlib: it extends its last
+ * segment in place while that segment is still at the top of the heap,
+ * and otherwise starts a new one with its own prologue and epilogue.
+ * Segments are appended to an address-sorted table, so mm_free finds
+ * the owning arena by binary search. Each thread also keeps a small
+ * cache of freed blocks per slab class that malloc and free use without
+ * taking any lock; the cache is flushed back when the thread exits.
+ *
+ * Blocks from mm_halloc are reached through a handle instead of a
+ * pointer. Their header is tagged HANDLE_BLOCK and their last word
+ * names the handle, whose slot in a table outside the heap holds the
+ * block's offset and a pin count. mm_compact walks each segment and
+ * slides every unpinned handle block down over the free space before
+ * it, so the holes between them merge into one free block at the
+ * segment end, which is then trimmed off the heap top.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#ifdef MM_THREADS
+#include <pthread.h>
+#endif
 
 #include "mm.h"
 #include "memlib.h"
-
-/* single word (4) or double word (8) alignment */
-#define ALIGNMENT 8
+#include "config.h"
 
 /* rounds up to the nearest multiple of ALIGNMENT */
-#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
+#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
 #define SIZE_T_SIZE (ALIGN(sizeof(size_t)))
 
 #define WORD_SIZE 4                                                                             // Word의 크기(4바이트)를 정의. 헤더 및 풋터의 최소 크기로 사용
 #define DOUBLE_WORD_SIZE 8                                                                      // Double Word의 크기(8바이트)를 정의. 블록 크기 정렬과 최소 블록 크기로 사용
 #define CHUNK_SIZE (1<<12)                                                                      // 힙 확장을 위한 기본 크기(4KB). 메모리 할당 요청 시 힙을 이만큼 늘림
+#define MIN_BLOCK_SIZE (2 * DOUBLE_WORD_SIZE)                                                   // 헤더 + pred/succ 오프셋 + 풋터가 들어가는 최소 블록 크기(16바이트)
 #define MAX_VALUE(x,y) ((x) > (y) ? (x) : (y))                                                  // 두 값 x, y 중 더 큰 값을 반환. 메모리 관리 시 크기 비교에 사용
+#define MIN_VALUE(x,y) ((x) < (y) ? (x) : (y))                                                  // 두 값 x, y 중 더 작은 값을 반환
 #define PACK_BLOCK(size,alloc) ((size) | (alloc))                                               // 블록 크기와 할당 상태를 하나의 값으로 결합
+#define PREV_ALLOC 0x2                                                                          // 헤더의 bit 1: 이전 블록이 할당 상태인지 표시 (할당 블록은 풋터가 없으므로 필요)
+#define MMAPPED 0x4                                                                             // 헤더의 bit 2: 힙 밖의 별도 mapping에 있는 큰 블록
+#define HANDLE_BLOCK 0x4                                                                        // 헤더의 bit 2: 힙 안에서는 compactor가 옮길 수 있는 handle 블록 (MMAPPED와는 주소로 구분)
 #define GET_WORD(p) (*(unsigned int*)(p))                                                       // 포인터 p가 가리키는 메모리 주소에서 4바이트 값을 읽어옴
 #define PUT_WORD(p,val) (*(unsigned int*)(p) = (val))                                           // 포인터 p가 가리키는 메모리 주소에 4바이트 값을 씀
 #define GET_BLOCK_SIZE(p) (GET_WORD(p) & ~0x7)                                                  // 포인터 p가 가리키는 헤더 또는 풋터에서 블록 크기를 읽음 / 하위 3비트(~0x7)를 제거하여 순수한 블록 크기만 가져옴
 #define GET_ALLOC_STATUS(p) (GET_WORD(p) & 0x1)                                                 // 포인터 p가 가리키는 헤더 또는 풋터에서 할당 상태(0 또는 1)를 읽음
+#define GET_PREV_ALLOC(p) (GET_WORD(p) & PREV_ALLOC)                                            // 헤더에서 이전 블록의 할당 상태를 읽음
+#define SET_PREV_ALLOC(p) PUT_WORD(p, GET_WORD(p) | PREV_ALLOC)                                 // 헤더에 이전 블록이 할당되었음을 기록
+#define CLEAR_PREV_ALLOC(p) PUT_WORD(p, GET_WORD(p) & ~PREV_ALLOC)                              // 헤더에 이전 블록이 free임을 기록
 #define HEADER_PTR(bp) ((char*)(bp) - WORD_SIZE)                                                // 블록 포인터(bp)에서 헤더의 시작 주소를 계산
-#define FOOTER_PTR(bp) ((char*)(bp) + GET_BLOCK_SIZE(HEADER_PTR(bp)) - DOUBLE_WORD_SIZE)        // 블록 포인터(bp)와 헤더 크기, 블록 크기를 이용하여 풋터의 시작 주소를 계산
+#define FOOTER_PTR(bp) ((char*)(bp) + GET_BLOCK_SIZE(HEADER_PTR(bp)) - DOUBLE_WORD_SIZE)        // 블록 포인터(bp)와 헤더 크기, 블록 크기를 이용하여 풋터의 시작 주소를 계산 (free 블록만 풋터를 가짐)
 #define NEXT_BLOCK_PTR(bp) ((char*)(bp) + GET_BLOCK_SIZE(((char*)(bp) - WORD_SIZE)))            // 블록 포인터(bp)에서 현재 블록의 크기를 더해 다음 블록의 시작 주소를 계산
-#define PREVIOUS_BLOCK_PTR(bp) ((char*)(bp) - GET_BLOCK_SIZE(((char*)(bp) - DOUBLE_WORD_SIZE))) // 블록 포인터(bp)에서 이전 블록의 크기를 빼서 이전 블록의 시작 주소를 계산
+#define PREVIOUS_BLOCK_PTR(bp) ((char*)(bp) - GET_BLOCK_SIZE(((char*)(bp) - DOUBLE_WORD_SIZE))) // 블록 포인터(bp)에서 이전 블록의 크기를 빼서 이전 블록의 시작 주소를 계산 (이전 블록이 free일 때만 유효)
+
+// Free 블록 연결 정보 (payload 안에 힙 시작 주소 기준 32비트 오프셋으로 저장, 0은 NULL)
+#define OFFSET_TO_PTR(off) ((off) ? heap_base + (off) : NULL)                                  // 오프셋을 실제 주소로 변환
+#define PTR_TO_OFFSET(p) ((p) ? (unsigned int)((char*)(p) - heap_base) : 0)                     // 실제 주소를 오프셋으로 변환
+#define GET_PRED(bp) OFFSET_TO_PTR(GET_WORD(bp))                                                // 같은 리스트의 이전 free 블록
+#define GET_SUCC(bp) OFFSET_TO_PTR(GET_WORD((char*)(bp) + WORD_SIZE))                           // 같은 리스트의 다음 free 블록
+#define SET_PRED(bp,p) PUT_WORD(bp, PTR_TO_OFFSET(p))                                           // 이전 free 블록 설정
+#define SET_SUCC(bp,p) PUT_WORD((char*)(bp) + WORD_SIZE, PTR_TO_OFFSET(p))                      // 다음 free 블록 설정
+
+// TLSF 인덱스 구성
+#define SL_INDEX_LOG2 4                                                                         // 2단계 클래스 수의 log2 (2의 거듭제곱 구간을 16개로 나눔)
+#define SL_INDEX_COUNT (1 << SL_INDEX_LOG2)                                                     // 2단계 클래스 수
+#if ALIGNMENT == 16
+#define ALIGNMENT_LOG2 4                                                                        // log2(ALIGNMENT)
+#else
+#define ALIGNMENT_LOG2 3
+#endif
+#define FL_INDEX_SHIFT (SL_INDEX_LOG2 + ALIGNMENT_LOG2)                                         // 이보다 작은 크기는 1단계 0번에 ALIGNMENT 간격으로 선형 매핑
+#define FL_INDEX_COUNT (32 - FL_INDEX_SHIFT + 1)                                                // 32비트 블록 크기를 모두 덮는 1단계 클래스 수
+#define SMALL_BLOCK_SIZE (1 << FL_INDEX_SHIFT)                                                  // 선형 매핑 구간의 상한(8바이트 정렬에서 128바이트, 16바이트 정렬에서 256바이트)
+
+// 큰 free 블록용 red-black tree (pred/succ 자리를 left/right로, 세 번째 워드를 parent + 색으로 사용)
+#define LARGE_BLOCK_SIZE 1024                                                                   // 이 크기 이상의 free 블록은 TLSF 리스트 대신 트리에 보관
+#define TREE_LEFT(bp) GET_PRED(bp)                                                              // 왼쪽 자식 (더 작은 키)
+#define TREE_RIGHT(bp) GET_SUCC(bp)                                                             // 오른쪽 자식 (더 큰 키)
+#define SET_LEFT(bp,p) SET_PRED(bp,p)
+#define SET_RIGHT(bp,p) SET_SUCC(bp,p)
+#define PARENT_WORD(bp) ((char*)(bp) + DOUBLE_WORD_SIZE)                                        // parent 오프셋과 색을 담는 워드 (bit 0 = red)
+#define TREE_PARENT(bp) OFFSET_TO_PTR(GET_WORD(PARENT_WORD(bp)) & ~0x1)                         // 부모 노드
+#define SET_PARENT(bp,p) PUT_WORD(PARENT_WORD(bp), PTR_TO_OFFSET(p) | (GET_WORD(PARENT_WORD(bp)) & 0x1)) // 색은 유지하고 부모만 변경
+#define IS_RED(bp) ((bp) != NULL && (GET_WORD(PARENT_WORD(bp)) & 0x1))                          // NULL 노드는 black
+#define SET_RED(bp) PUT_WORD(PARENT_WORD(bp), GET_WORD(PARENT_WORD(bp)) | 0x1)
+#define SET_BLACK(bp) PUT_WORD(PARENT_WORD(bp), GET_WORD(PARENT_WORD(bp)) & ~0x1)
+
+// Slab 구성
+#define SLAB_RUN_SHIFT 12                                                                       // run 크기의 log2
+#define SLAB_RUN_SIZE (1 << SLAB_RUN_SHIFT)                                                     // 한 run의 크기(4KB 페이지)
+#define SLAB_MAX_SIZE 256                                                                       // slab으로 처리하는 최대 요청 크기
+#define SLAB_CLASS_COUNT 16                                                                     // slab 크기 클래스 수
+#define SLAB_WARMUP 64                                                                          // 작은 객체가 이만큼 살아있을 때만 slab 사용 (작은 객체가 적은 trace에서 run 낭비 방지)
+#define SLAB_BLOCK_LIMIT ALIGN(SLAB_MAX_SIZE + WORD_SIZE)                                       // 작은 요청이 일반 힙에서 차지하는 최대 블록 크기
+#define SLAB_BITMAP_WORDS (SLAB_RUN_SIZE / ALIGNMENT / 32)                                      // 가장 작은 클래스의 슬롯 수를 덮는 비트맵 워드 수
+#define SLAB_MAP_WORDS(heap) (((heap) / SLAB_RUN_SIZE + 31) / 32)                               // 최대 힙 크기 전체의 run 위치를 표시하는 페이지 맵 워드 수
+#define DEFAULT_TRIM_THRESHOLD (256 * 1024)                                                     // 힙 끝의 free 블록이 이보다 크면 memlib에 반환
+#define DEFAULT_TOP_PAD (64 * 1024)                                                             // 반환 후에도 힙 끝에 남겨두는 free 공간 (반환과 확장의 반복 방지)
+#define DEFAULT_MMAP_THRESHOLD (256 * 1024)                                                     // 이 크기 이상의 요청은 별도 mapping에 할당
+#define DEFAULT_GROW_POLICY MM_GROW_SHORTFALL                                                   // 힙 확장 정책 (mm.h의 MM_GROW_*)
+#define DEFAULT_GROW_CAP (128 * 1024)                                                           // MM_GROW_GEOMETRIC에서 한 번에 늘리는 최대 크기
+#define DEFAULT_CHECK_INTERVAL 1000                                                             // MM_CHECK_SAMPLED에서 힙 전체를 훑는 호출 간격
+
+// 배치 정책: 컴파일할 때 -DMM_FIT=<번호>로 고르며 fit_finder가 정책마다 따로 컴파일됨 (실행 중 분기 없음)
+#define MM_FIT_GOOD 0                                                                           // TLSF good fit: 클래스 경계로 올림하여 O(1), 큰 블록은 트리 best fit (기본)
+#define MM_FIT_FIRST 1                                                                          // 요청 크기의 클래스부터 리스트 순서대로 처음 맞는 블록
+#define MM_FIT_BEST 2                                                                           // 맞는 블록 중 가장 작은 블록 (클래스 리스트를 끝까지 훑음)
+#define MM_FIT_NEXT 3                                                                           // 힙을 주소 순으로 훑되 지난번에 고른 블록부터 (next fit)
+#define MM_FIT_ADDRESS 4                                                                        // 힙을 처음부터 주소 순으로 훑어 처음 맞는 블록 (address-ordered first fit)
+#ifndef MM_FIT
+#define MM_FIT MM_FIT_GOOD
+#endif
+#define MM_FIT_WALKS (MM_FIT == MM_FIT_NEXT || MM_FIT == MM_FIT_ADDRESS)                       // 힙을 훑는 정책이면 1 (클래스 검색 함수는 컴파일하지 않음)
+#if MM_FIT == MM_FIT_NEXT
+#define ROVER_MERGE(ar, bp) do { if ((ar)->rover > (char *)(bp) && (ar)->rover < (char *)NEXT_BLOCK_PTR(bp)) (ar)->rover = (char *)(bp); } while (0) // rover가 병합된 블록 안쪽이 되었으면 그 블록의 시작으로 옮김
+#else
+#define ROVER_MERGE(ar, bp) ((void)0)
+#endif
+#ifndef MM_SPLIT_THRESHOLD
+#define MM_SPLIT_THRESHOLD MIN_BLOCK_SIZE                                                       // 남는 부분이 이보다 작으면 분할하지 않고 블록에 포함 (-DMM_SPLIT_THRESHOLD로 변경)
+#endif
+#if MM_SPLIT_THRESHOLD < MIN_BLOCK_SIZE
+#error "MM_SPLIT_THRESHOLD must be at least MIN_BLOCK_SIZE"
+#endif
+
+// 별도 mapping 블록: mapping 맨 앞에 길이, payload 바로 앞에 MMAPPED 헤더
+#define MMAP_OVERHEAD (2 * DOUBLE_WORD_SIZE)                                                    // 길이 + 패딩 + 헤더 (payload 정렬 유지)
+#define MMAP_START(bp) ((char *)(bp) - MMAP_OVERHEAD)                                           // payload에서 mapping 시작 주소를 계산
+#define MMAP_LENGTH(bp) (*(size_t *)MMAP_START(bp))                                             // mapping 전체 길이
+#define IS_MMAPPED_PTR(p) ((size_t)((char *)(p) - heap_base) >= heap_limit)                     // memlib 힙 예약 범위 밖이면 mapping 블록
+#define MAX_HEAP_OFFSET 0x100000000ULL                                                          // 32비트 오프셋으로 가리킬 수 있는 최대 힙 크기(4GB)
+#define SLAB_PAGE(p) ((unsigned int)((char*)(p) - heap_base) >> SLAB_RUN_SHIFT)                 // 포인터가 속한 페이지 번호 (힙 시작 기준)
+#define SLAB_RUN_PTR(p) ((slab_run_t*)(heap_base + ((size_t)SLAB_PAGE(p) << SLAB_RUN_SHIFT)))   // 포인터가 속한 run의 헤더
+#define IS_SLAB_PTR(p) ((MAP_WORD(SLAB_PAGE(p) >> 5) >> (SLAB_PAGE(p) & 31)) & 1)                  // 포인터가 slab run 안에 있는지 확인
+
+// Slab run 헤더 (run의 맨 앞에 위치, 슬롯은 그 뒤부터 시작)
+typedef struct slab_run {
+    unsigned short class_idx;                // 크기 클래스 번호
+    unsigned short free_count;               // 비어있는 슬롯 수
+    struct slab_run *prev;                   // 같은 클래스의 partial run 리스트
+    struct slab_run *next;
+    unsigned int bitmap[SLAB_BITMAP_WORDS];  // 1 = 비어있는 슬롯
+} slab_run_t;
+
+#define SLAB_FIRST_SLOT ALIGN(sizeof(slab_run_t))                                               // run 안에서 첫 슬롯의 오프셋
+#define SLAB_RUN_SLOTS(slot_size) ((SLAB_RUN_SIZE - WORD_SIZE - SLAB_FIRST_SLOT) / (slot_size)) // run 하나의 슬롯 수 (run 블록의 마지막 워드는 다음 블록의 헤더)
+
+// Arena: 하나의 잠금 아래에서 관리되는 free 인덱스와 slab 상태
+typedef struct arena {
+    unsigned int fl_bitmap;                                  // 비어있지 않은 1단계 클래스 비트맵
+    unsigned int sl_bitmap[FL_INDEX_COUNT];                  // 1단계 클래스별로 비어있지 않은 2단계 클래스 비트맵
+    char *free_lists[FL_INDEX_COUNT][SL_INDEX_COUNT];        // 각 클래스 free 리스트의 head
+    char *large_root;                                        // 큰 free 블록 red-black tree의 root
+    struct slab_run *slab_partial[SLAB_CLASS_COUNT];         // 비어있는 슬롯이 있는 run 리스트
+    unsigned int small_live;                                 // 살아있는 작은 객체 수 (slab + 일반 힙, warm-up 판단)
+    char *heap_end;                                          // 마지막 segment의 끝 (에필로그 헤더 다음 주소), 없으면 NULL
+    size_t grow_step;                                        // MM_GROW_GEOMETRIC에서 다음 확장의 최소 크기
+    char *rover;                                             // MM_FIT_NEXT: 지난번에 고른 블록 (항상 블록의 시작, 없으면 NULL)
+    int rover_segment;                                       // MM_FIT_NEXT: rover가 있는 segment의 번호
+    char *zero_lo;                                           // 확장 직전에 memlib이 0으로 알던 영역의 시작 (mm_calloc이 확장 전에 NULL로 둠)
+#ifdef MM_STATS
+    unsigned int visits;                                     // 지금 검색에서 본 블록 수
+#endif
+#ifdef MM_THREADS
+    pthread_mutex_t lock;                                    // arena 잠금
+#endif
+} arena_t;
+
+// Segment: memlib 힙에서 한 arena가 연속으로 차지하는 구간 (프롤로그 ~ 에필로그)
+typedef struct segment {
+    char *start;                                             // segment의 첫 주소 (정렬 패딩 워드)
+    arena_t *arena;                                          // segment를 소유한 arena
+} segment_t;
+
+// Region arena chunk 헤더 (chunk의 맨 앞에 위치, 객체는 그 뒤에 헤더 없이 이어짐)
+typedef struct region_chunk {
+    struct region_chunk *next;                               // 같은 arena의 다음 chunk
+} region_chunk_t;
+
+// Region arena: mm_malloc에서 받은 chunk를 앞에서부터 잘라 씀 (mm.h의 mm_arena_t, 첫 chunk의 맨 앞에 위치)
+struct mm_arena {
+    region_chunk_t *chunks;                                  // 첫 chunk 뒤에 받은 chunk와 큰 객체 블록 (reset 때 반환)
+    char *cur;                                               // 지금 chunk 안의 다음 빈 주소
+    char *end;                                               // 지금 chunk의 끝 주소
+    size_t chunk_size;                                       // 다음에 새로 받을 chunk의 크기
+};
+
+#define REGION_CHUNK_SIZE (1<<12)                                                               // mm_arena_create(0)의 첫 chunk 크기
+#define REGION_MAX_CHUNK (1<<13)                                                                // 새 chunk는 두 배씩 커지다가 이 크기에서 멈춤
+#define REGION_HEADER ALIGN(sizeof(region_chunk_t))                                             // chunk 안에서 첫 객체의 오프셋
+#define REGION_FIRST ALIGN(sizeof(struct mm_arena))                                             // 첫 chunk 안에서 첫 객체의 오프셋 (arena 헤더 다음)
+
+// Pool: 크기가 같은 객체를 스레드별 magazine과 lock 없는 depot으로 주고받음 (mm.h의 mm_pool_t)
+struct mm_pool {
+    unsigned long long depot __attribute__((aligned(8)));    // 객체 묶음의 Treiber stack head (세대 << 32 | 첫 묶음의 오프셋)
+    size_t obj_size;                                         // 객체 크기 (정렬 단위로 올림)
+    char *chunks;                                            // 힙에서 받은 chunk 리스트 (chunk 첫 워드에 다음 chunk)
+    char *cur;                                               // 지금 chunk에서 아직 나눠주지 않은 첫 주소
+    char *end;                                               // 지금 chunk의 끝 주소
+    unsigned int generation;                                 // 만들거나 없앨 때마다 증가, 지난 pool을 가리키는 magazine을 무효화
+    int in_use;                                              // pool 표의 이 칸이 쓰이는 중이면 1
+#ifdef MM_THREADS
+    pthread_mutex_t lock;                                    // 새 chunk를 나눌 때만 잡음
+#endif
+};
+
+// Magazine: 스레드가 pool 하나에 대해 들고 있는 객체 묶음 (첫 워드로 연결)
+typedef struct pool_magazine {
+    mm_pool_t *pool;                                         // 묶여 있는 pool
+    unsigned int generation;                                 // 묶을 때의 pool 세대
+    unsigned int count;                                      // 묶음의 객체 수
+    char *head;                                              // 묶음의 첫 객체
+} pool_magazine_t;
+
+#define POOL_COUNT 64                                                                           // 동시에 있을 수 있는 pool 수
+
+// Handle 표의 한 칸: handle 블록의 현재 위치와 고정 횟수 (handle = 칸 번호 + 1)
+typedef struct handle_entry {
+    unsigned int offset;                                     // 블록의 힙 오프셋 (빈 칸이면 0)
+    unsigned int pins;                                       // mm_hlock 횟수 (0일 때만 compactor가 옮김)
+    unsigned int next;                                       // 빈 칸이면 다음 빈 칸의 handle (0이면 끝)
+} handle_entry_t;
+
+#define HANDLE_TABLE_MIN 1024                                                                   // 처음 mapping하는 handle 표의 칸 수 (가득 차면 두 배로)
+#define HANDLE_INDEX(bp) FOOTER_PTR(bp)                                                         // handle 블록의 마지막 워드: 블록을 가리키는 handle (compactor가 표의 칸을 찾음)
+#define HANDLE_ASIZE(size) ((size) <= MIN_BLOCK_SIZE - DOUBLE_WORD_SIZE ? MIN_BLOCK_SIZE : ALIGN((size) + DOUBLE_WORD_SIZE)) // 헤더와 handle 워드를 더한 블록 크기
+#define POOL_CHUNK_SIZE (1<<14)                                                                 // pool이 힙에서 한 번에 받는 chunk의 최소 크기
+#define POOL_MAGAZINE_SIZE 32                                                                   // magazine 하나(= depot 묶음 하나)의 객체 수
+#define POOL_MAGAZINE_SLOTS 8                                                                   // 스레드마다 magazine을 둘 pool 수 (pool 번호로 칸을 고름)
+#define POOL_MIN_OBJECT (3 * WORD_SIZE)                                                         // 묶음 첫 객체에 다음 객체, 다음 묶음, 묶음 크기를 담음
+#define POOL_CHUNK_HEADER ALIGN(sizeof(char *))                                                 // chunk 안에서 첫 객체의 오프셋
+#define DEPOT_HEAD(tag,off) (((unsigned long long)(tag) << 32) | (off))                         // 세대와 오프셋을 한 워드로 묶음 (CAS 한 번에 바꿈)
+#define DEPOT_TAG(head) ((unsigned int)((head) >> 32))                                          // pop/push마다 증가하는 세대 (ABA 방지)
+#define DEPOT_OFFSET(head) ((unsigned int)(head))                                               // 맨 위 묶음의 오프셋 (0이면 비어있음)
+#define CHAIN_NEXT(bp) ((char*)(bp) + WORD_SIZE)                                                // depot에서 다음 묶음의 오프셋을 담는 워드
+#define CHAIN_COUNT(bp) ((char*)(bp) + DOUBLE_WORD_SIZE)                                        // 묶음의 객체 수를 담는 워드
+
+#ifdef MM_THREADS
+#define ARENA_COUNT 8                                                                           // arena 수 (스레드는 차례대로 배정됨)
+#define SEGMENT_MIN_SIZE (CHUNK_SIZE * 16)                                                      // 새 segment의 최소 크기 (arena끼리 번갈아 확장할 때 segment가 잘게 쪼개지지 않게)
+#define TCACHE_COUNT 16                                                                         // thread cache 클래스별 최대 블록 수
+#define ARENA_LOCK(ar) pthread_mutex_lock(&(ar)->lock)
+#define ARENA_UNLOCK(ar) pthread_mutex_unlock(&(ar)->lock)
+#define SBRK_LOCK() pthread_mutex_lock(&sbrk_lock)
+#define SBRK_UNLOCK() pthread_mutex_unlock(&sbrk_lock)
+#define MAP_WORD(i) __atomic_load_n(&slab_page_map[i], __ATOMIC_RELAXED)                        // 다른 arena가 같은 맵 워드를 바꿀 수 있으므로 원자적으로 접근
+#define MAP_SET(i,bits) __atomic_fetch_or(&slab_page_map[i], (bits), __ATOMIC_RELAXED)
+#define MAP_CLEAR(i,bits) __atomic_fetch_and(&slab_page_map[i], ~(bits), __ATOMIC_RELAXED)
+#define COUNT_COPY(n) __atomic_fetch_add(&copy_bytes, (n), __ATOMIC_RELAXED)
+#define POOL_LOCK(pool) pthread_mutex_lock(&(pool)->lock)
+#define POOL_UNLOCK(pool) pthread_mutex_unlock(&(pool)->lock)
+#define HANDLE_LOCK() pthread_mutex_lock(&handle_lock)
+#define HANDLE_UNLOCK() pthread_mutex_unlock(&handle_lock)
+#else
+#define ARENA_COUNT 1
+#define ARENA_LOCK(ar) ((void)(ar))
+#define ARENA_UNLOCK(ar) ((void)(ar))
+#define SBRK_LOCK()
+#define SBRK_UNLOCK()
+#define MAP_WORD(i) (slab_page_map[i])
+#define MAP_SET(i,bits) (slab_page_map[i] |= (bits))
+#define MAP_CLEAR(i,bits) (slab_page_map[i] &= ~(bits))
+#define COUNT_COPY(n) (copy_bytes += (n))
+#define POOL_LOCK(pool)
+#define POOL_UNLOCK(pool)
+#define HANDLE_LOCK()
+#define HANDLE_UNLOCK()
+#endif
+
+// Telemetry (-DMM_STATS, 꺼져 있으면 코드가 생기지 않음)
+#ifdef MM_STATS
+#ifdef MM_THREADS
+#define STAT_ADD(field,n) __atomic_fetch_add(&telemetry.field, (n), __ATOMIC_RELAXED)
+#else
+#define STAT_ADD(field,n) (telemetry.field += (n))
+#endif
+#define STAT_VISIT(ar) ((ar)->visits++)                                                         // 지금 검색에서 블록 하나를 봄 (arena 잠금 아래)
+#else
+#define STAT_ADD(field,n) ((void)0)
+#define STAT_VISIT(ar) ((void)0)
+#endif
+#define STAT_INC(field) STAT_ADD(field, 1)
+#define STAT_BUCKET(v) ((v) == 0 ? 0 : MIN_VALUE(64 - __builtin_clzll((unsigned long long)(v)), MM_STATS_BUCKETS - 1)) // 2^(b-1) <= v < 2^b이면 히스토그램 칸 b (0은 0번 칸)
+
+// 일관성 검사 (mm_setopt(MM_CHECK_LEVEL)로 켰을 때만 호출마다 검사 함수를 부름)
+#define CALL_CHECK(ptr,where) do { if (check_level != MM_CHECK_OFF) call_checker((ptr), (where)); } while (0) // 이 호출이 받거나 돌려주는 블록 검사
+#define MAX_SEGMENTS 1024                                                                       // segment 표의 크기
 
 // Pointer
-static char *heap_p; // heap의 시작주소 저장
-static char *next_p; // Next Fit 탐색에서 블록 탐색을 시작할 위치를 저장
+static char *heap_base; // free 리스트 오프셋의 기준 주소 (mem_heap_lo)
+
+// 조정 가능한 값 (mm_setopt, mm_init을 다시 호출해도 유지)
+static size_t trim_threshold = DEFAULT_TRIM_THRESHOLD;
+static size_t top_pad = DEFAULT_TOP_PAD;
+static size_t mmap_threshold = DEFAULT_MMAP_THRESHOLD;
+static int grow_policy = DEFAULT_GROW_POLICY;
+static size_t grow_cap = DEFAULT_GROW_CAP;
+static int check_level = MM_CHECK_OFF;
+static size_t check_interval = DEFAULT_CHECK_INTERVAL;
+static size_t heap_limit;   // memlib 힙 예약 범위의 크기
+static size_t page_size;    // mapping 길이를 맞출 페이지 크기
+static size_t copy_bytes;   // mm_realloc이 복사하거나 옮긴 payload 바이트 수 (mm_init마다 0)
+static size_t check_calls;  // MM_CHECK_SAMPLED에서 지난 전체 검사 뒤의 호출 수
+
+// Arena와 segment 표 (segment는 주소 순으로 추가만 됨)
+#ifdef MM_THREADS
+static arena_t arenas[ARENA_COUNT] __attribute__((aligned(64)));
+#else
+static arena_t arenas[ARENA_COUNT];
+#endif
+static segment_t segments[MAX_SEGMENTS];
+static int segment_count;
+
+// Pool 표 (pool은 힙 밖에 있어 mm_init 후에도 칸이 남지만 세대가 바뀜)
+static mm_pool_t pools[POOL_COUNT];
+
+// Handle 표 (힙 밖의 mapping에 두어 compactor가 넘지 못하는 블록을 만들지 않음)
+static handle_entry_t *handle_table;
+static unsigned int handle_capacity;                         // mapping된 칸 수
+static unsigned int handle_count;                            // 한 번이라도 쓰인 칸 수 (mm_init마다 0)
+static unsigned int handle_free;                             // 빈 칸 리스트의 첫 handle (0이면 없음)
+
+#ifdef MM_STATS
+static mm_stats_t telemetry;                                 // mm_stats가 돌려주는 값 (mm_init마다 0)
+#endif
+
+// Slab 상태
+#if ALIGNMENT == 16
+static const unsigned int slab_class_size[SLAB_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256
+};
+#else
+static const unsigned int slab_class_size[SLAB_CLASS_COUNT] = {
+    8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+#endif
+static unsigned int *slab_page_map;                          // run이 시작하는 페이지 비트맵 (최대 힙 크기에 맞춰 mmap)
+static size_t slab_map_words;                                // 페이지 맵의 워드 수
+static unsigned int slab_map_hi;                             // 힙이 덮은 페이지 맵 워드 수 (mm_init에서 여기까지만 지움)
+
+#ifdef MM_THREADS
+// Thread cache: 스레드별로 크기 클래스마다 해제된 작은 블록을 단일 연결 리스트로 보관 (arena 입장에서는 할당 상태)
+typedef struct tcache {
+    void *bins[SLAB_CLASS_COUNT];                            // 클래스별 리스트 head (payload 첫 워드에 다음 포인터)
+    unsigned int counts[SLAB_CLASS_COUNT];                   // 클래스별 블록 수
+    unsigned int generation;                                 // 채워질 때의 힙 세대
+} tcache_t;
+
+static pthread_mutex_t sbrk_lock = PTHREAD_MUTEX_INITIALIZER; // mem_sbrk와 segment 표 보호
+static pthread_mutex_t handle_lock = PTHREAD_MUTEX_INITIALIZER; // handle 표 보호 (arena 잠금보다 먼저 잡음)
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t tcache_key;                             // 스레드 종료 시 thread cache를 비우기 위한 키
+static unsigned int heap_generation;                         // mm_init마다 증가, 이전 힙을 가리키는 thread cache를 무효화
+static unsigned int next_arena;                              // 다음 스레드에 배정할 arena 번호
+static __thread tcache_t tcache;
+static __thread arena_t *thread_arena;                       // 이 스레드에 배정된 arena
+static __thread pool_magazine_t pool_magazines[POOL_MAGAZINE_SLOTS];
+static unsigned long long fork_pools;                        // mm_fork_lock이 잠근 pool (pool 번호의 비트, handle 잠금 아래)
+#else
+static pool_magazine_t pool_magazines[POOL_MAGAZINE_SLOTS];
+#endif
 
 // define functions
-static void *heap_extender(size_t size);
-static void *coalescer(void* bp);
-static void *fit_finder(size_t size);
-static void placer(void *bp, size_t asize);
+static arena_t *arena_current(void);
+static void *arena_malloc(arena_t *ar, size_t size);
+static void arena_free(arena_t *ar, void *ptr);
+static void run_releaser(arena_t *ar, char *bp, size_t size);
+static size_t batch_carver(arena_t *ar, char *bp, size_t asize, size_t count, void **out);
+static int address_compare(const void *a, const void *b);
+static void *region_refiller(mm_arena_t *arena, size_t size);
+static pool_magazine_t *pool_magazine(mm_pool_t *pool);
+static unsigned int magazine_loader(mm_pool_t *pool, pool_magazine_t *mag);
+static void magazine_flusher(pool_magazine_t *mag);
+static void depot_push(mm_pool_t *pool, char *chain, unsigned int count);
+static char *depot_pop(mm_pool_t *pool, unsigned int *count);
+static unsigned int handle_reserver(void);
+static size_t segment_slider(arena_t *ar, char *bp);
+static void gap_closer(arena_t *ar, char *gap, char *bp);
+static arena_t *arena_of(void *ptr);
+static void *heap_extender(arena_t *ar, size_t size);
+static size_t grow_size(arena_t *ar, size_t size);
+static void heap_trimmer(arena_t *ar, char *bp);
+static void *mmap_alloc(size_t size);
+static void *mmap_realloc(void *ptr, size_t size);
+static void mmap_free(void *ptr);
+static size_t next_free_size(void *bp);
+static void next_absorber(arena_t *ar, void *bp, size_t asize);
+static void tail_splitter(arena_t *ar, void *bp, size_t asize);
+static void *coalescer(arena_t *ar, void* bp);
+static void *fit_finder(arena_t *ar, size_t size);
+static void *fit_searcher(arena_t *ar, size_t size);
+#if MM_FIT_WALKS
+static void *block_walker(arena_t *ar, char *bp, char *stop, size_t size);
+#else
+static char *class_finder(arena_t *ar, int *fl, int *sl);
+#endif
+static void placer(arena_t *ar, void *bp, size_t asize);
+static void mapping_insert(size_t size, int *fl, int *sl);
+#if MM_FIT == MM_FIT_GOOD
+static void mapping_search(size_t size, int *fl, int *sl);
+#endif
+static void insert_free_block(arena_t *ar, void *bp);
+static void remove_free_block(arena_t *ar, void *bp);
+static int tree_compare(size_t size, char *addr, char *bp);
+static void tree_rotate_left(arena_t *ar, char *x);
+static void tree_rotate_right(arena_t *ar, char *x);
+static void tree_transplant(arena_t *ar, char *u, char *v);
+static void tree_insert(arena_t *ar, char *bp);
+static void tree_remove(arena_t *ar, char *bp);
+#if !MM_FIT_WALKS
+static char *tree_best_fit(arena_t *ar, size_t size);
+#endif
+static void *aligned_block(arena_t *ar, size_t align, size_t asize);
+static char *align_in_block(char *bp, size_t align, size_t asize);
+static int slab_class(size_t size);
+static void *slab_alloc(arena_t *ar, int class_idx);
+static void slab_free(arena_t *ar, void *ptr);
+static void call_checker(void *ptr, const char *where);
+static int block_checker(void *ptr, const char *where);
+static int heap_checker(arena_t *ar, int level);
+static int tree_checker(char *node, char *parent, char **prev, size_t *count);
+static int check_failer(const char *where, void *bp, const char *what);
+#ifdef MM_THREADS
+static void tcache_reset(void);
+static void tcache_flush(void *unused);
+static void tcache_create_key(void);
+#endif
 
-/* 
+/*
  * mm_init - initialize the malloc package.
  */
 int mm_init(void)
-{  
-    // 힙을 초기화하고 초기 메모리를 요청한다.
-    void *initial_heap = mem_sbrk(4 * WORD_SIZE);
-    if (initial_heap == (void *)-1) 
-    { 
-        // 메모리 요청 실패 시 -1 반환
-        return -1;
+{
+    arena_t *ar;
+    int i;
+
+    heap_base = mem_heap_lo();
+    heap_limit = mem_maxheap();
+    page_size = mem_pagesize();
+    copy_bytes = 0;
+    check_calls = 0;
+#ifdef MM_STATS
+    memset(&telemetry, 0, sizeof(telemetry));
+#endif
+
+    // 모든 arena의 TLSF 인덱스와 slab 상태를 비움 (mdriver는 trace마다 mm_init을 다시 호출)
+    for (i = 0; i < ARENA_COUNT; i++)
+    {
+        ar = &arenas[i];
+        ar->fl_bitmap = 0;
+        memset(ar->sl_bitmap, 0, sizeof(ar->sl_bitmap));
+        memset(ar->free_lists, 0, sizeof(ar->free_lists));
+        ar->large_root = NULL;
+        memset(ar->slab_partial, 0, sizeof(ar->slab_partial));
+        ar->small_live = 0;
+        ar->heap_end = NULL;
+        ar->grow_step = CHUNK_SIZE;
+        ar->rover = NULL;
+        ar->rover_segment = 0;
+#ifdef MM_THREADS
+        pthread_mutex_init(&ar->lock, NULL);
+#endif
     }
+    segment_count = 0;
 
-    heap_p = initial_heap; // 힙의 시작 주소 설정
-
-    // 정렬 패딩(Alignment Padding)
-    // 첫 번째 워드는 정렬을 위해 비워둔다.
-    PUT_WORD(heap_p, 0);
-
-    // Prologue Header: 더블 워드 크기(8바이트) 블록, 할당 상태로 설정
-    PUT_WORD(heap_p + (1 * WORD_SIZE), PACK_BLOCK(DOUBLE_WORD_SIZE, 1));
-
-    // Prologue Footer: Header와 동일한 설정
-    PUT_WORD(heap_p + (2 * WORD_SIZE), PACK_BLOCK(DOUBLE_WORD_SIZE, 1));
-
-    // Epilogue Header: 크기 0, 할당 상태로 설정
-    PUT_WORD(heap_p + (3 * WORD_SIZE), PACK_BLOCK(0, 1));
-
-    // 힙 포인터를 프롤로그 블록의 끝(헤더와 풋터 사이)으로 이동
-    heap_p += (2 * WORD_SIZE);
+    // 이전 힙에 있던 pool은 모두 없어짐 (magazine은 세대로 무효화)
+    for (i = 0; i < POOL_COUNT; i++)
+    {
+        pools[i].generation++;
+        pools[i].in_use = 0;
+    }
 
-    // next_p는 탐색을 시작할 위치를 설정하기 위해 초기화
-    next_p = heap_p;
+    // 이전 힙의 handle은 모두 없어짐 (표의 mapping은 다시 씀)
+    handle_count = 0;
+    handle_free = 0;
 
-    // 초기 힙 크기를 확장하여 사용할 수 있는 메모리 공간을 추가
-    if (heap_extender(CHUNK_SIZE / WORD_SIZE) == NULL) 
+    // 페이지 맵은 memlib의 최대 힙 크기에 맞춰 잡음 (건드리지 않은 페이지는 메모리를 차지하지 않음)
+    if (mem_maxheap() > MAX_HEAP_OFFSET)
+    {
+        return -1;
+    }
+    if (slab_map_words != SLAB_MAP_WORDS(mem_maxheap()))
+    {
+        if (slab_page_map != NULL)
+        {
+            munmap(slab_page_map, slab_map_words * sizeof(unsigned int));
+        }
+        slab_map_words = SLAB_MAP_WORDS(mem_maxheap());
+        slab_page_map = mmap(NULL, slab_map_words * sizeof(unsigned int), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (slab_page_map == MAP_FAILED)
+        {
+            slab_page_map = NULL;
+            slab_map_words = 0;
+            return -1;
+        }
+    }
+    else
+    {
+        memset(slab_page_map, 0, slab_map_hi * sizeof(unsigned int));
+    }
+    slab_map_hi = 0;
+
+#ifdef MM_THREADS
+    // 이전 힙의 블록을 담고 있는 thread cache를 모두 무효화
+    pthread_once(&tcache_once, tcache_create_key);
+    heap_generation++;
+    next_arena = 0;
+    thread_arena = NULL;
+#endif
+
+    // 첫 arena의 segment(프롤로그 + 초기 free 블록 + 에필로그)를 만듦
+    if (heap_extender(&arenas[0], CHUNK_SIZE / WORD_SIZE) == NULL)
     {
         // 힙 확장이 실패하면 -1 반환
         return -1;
@@ -95,79 +566,126 @@ int mm_init(void)
 }
 
 
-/* 
- * mm_malloc - Allocate a block by incrementing the brk pointer.
- *     Always allocate a block whose size is a multiple of the alignment.
+/*
+ * mm_malloc - Allocate a block from the calling thread's arena. In the
+ *     thread-safe build small requests are served from the thread cache
+ *     first, without taking any lock.
  */
 void *mm_malloc(size_t size)
 {
+    arena_t *ar;
+    void *bp;
+
     // 예외 처리: 요청된 크기가 0이면 NULL 반환
-    if (size == 0) 
+    if (size == 0)
     {
         return NULL;
     }
+    STAT_INC(mallocs);
+    STAT_INC(size_hist[STAT_BUCKET(size)]);
 
-    // 요청된 크기에 따라 조정된 블록 크기를 계산
-    size_t adjusted_size;
-    if (size <= DOUBLE_WORD_SIZE) 
-    {
-        // 요청 크기가 최소 블록 크기 이하일 경우, 최소 블록 크기로 조정
-        adjusted_size = 2 * DOUBLE_WORD_SIZE;
-    } 
-    else 
+    // 아주 큰 요청은 힙 대신 별도 mapping에 할당 (실패하면 힙에서)
+    if (mmap_threshold > 0 && size >= mmap_threshold && (bp = mmap_alloc(size)) != NULL)
     {
-        // 요청 크기 + 헤더/풋터 크기를 더하고, 8바이트 정렬
-        adjusted_size = ALIGN(size + DOUBLE_WORD_SIZE);
+        return bp;
     }
 
-    // 조정된 크기를 만족하는 적합한 블록을 찾기
-    char *block_pointer = fit_finder(adjusted_size);
-
-    if (block_pointer == NULL) 
+#ifdef MM_THREADS
+    // 작은 요청은 thread cache에서 먼저 꺼냄
+    if (size <= SLAB_MAX_SIZE)
     {
-        // 적합한 블록이 없으면 힙을 확장하여 새 블록 할당
-        block_pointer = heap_extender(adjusted_size / WORD_SIZE);
-
-        // 힙 확장이 실패하면 NULL 반환
-        if (block_pointer == NULL) 
+        int class_idx = slab_class(size);
+        if (tcache.generation != heap_generation)
         {
-            return NULL;
+            tcache_reset();
+        }
+        if ((bp = tcache.bins[class_idx]) != NULL)
+        {
+            tcache.bins[class_idx] = *(void **)bp;
+            tcache.counts[class_idx]--;
+            STAT_INC(tcache_hits);
+            return bp;
         }
     }
+#endif
 
-    // 찾은 블록 또는 확장된 블록에 요청 크기를 배치
-    placer(block_pointer, adjusted_size);
-
-    // 사용 가능한 블록의 시작 주소 반환
-    return block_pointer;
+    ar = arena_current();
+    ARENA_LOCK(ar);
+    bp = arena_malloc(ar, size);
+    ARENA_UNLOCK(ar);
+    CALL_CHECK(bp, "mm_malloc");
+    return bp;
 }
 
 
 /*
- * mm_free - Freeing a block does nothing.
+ * mm_free - Return the block to the arena that owns it. In the
+ *     thread-safe build small blocks are kept in the thread cache until
+ *     their bin is full.
  */
 void mm_free(void *ptr)
 {
+    arena_t *ar;
+
     // 예외 처리: 유효하지 않은 포인터는 처리하지 않음
-    if (ptr == NULL) 
+    if (ptr == NULL)
     {
         return;
     }
+    STAT_INC(frees);
+    CALL_CHECK(ptr, "mm_free");
 
-    // 현재 블록의 크기를 가져옴
-    size_t size = GET_BLOCK_SIZE(HEADER_PTR(ptr));
+    // mapping 블록은 잠금 없이 바로 해제
+    if (IS_MMAPPED_PTR(ptr))
+    {
+        mmap_free(ptr);
+        return;
+    }
 
-    // 블록의 헤더와 풋터를 free 상태로 설정
-    PUT_WORD(HEADER_PTR(ptr), PACK_BLOCK(size, 0)); // 헤더에 크기와 할당 상태 저장
-    PUT_WORD(FOOTER_PTR(ptr), PACK_BLOCK(size, 0)); // 풋터에 크기와 할당 상태 저장
+#ifdef MM_THREADS
+    // 작은 블록은 사용 가능한 크기를 넘지 않는 가장 큰 클래스의 thread cache에 보관
+    int class_idx = -1;
+    if (IS_SLAB_PTR(ptr))
+    {
+        class_idx = SLAB_RUN_PTR(ptr)->class_idx;
+    }
+    else if (GET_BLOCK_SIZE(HEADER_PTR(ptr)) <= SLAB_BLOCK_LIMIT)
+    {
+        size_t usable = GET_BLOCK_SIZE(HEADER_PTR(ptr)) - WORD_SIZE;
+        class_idx = (usable >= SLAB_MAX_SIZE) ? SLAB_CLASS_COUNT - 1 : slab_class(usable + 1) - 1;
+    }
+    if (class_idx >= 0)
+    {
+        if (tcache.generation != heap_generation)
+        {
+            tcache_reset();
+        }
+        if (tcache.counts[class_idx] < TCACHE_COUNT)
+        {
+            *(void **)ptr = tcache.bins[class_idx];
+            tcache.bins[class_idx] = ptr;
+            tcache.counts[class_idx]++;
+            return;
+        }
+    }
+#endif
 
-    // 현재 블록을 병합하여 단편화를 줄임
-    coalescer(ptr);
+    // 블록이 속한 segment의 arena에 반환
+    ar = arena_of(ptr);
+    ARENA_LOCK(ar);
+    arena_free(ar, ptr);
+    ARENA_UNLOCK(ar);
 }
 
 
 /*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ * mm_realloc - Resize the block in place whenever its neighbours allow
+ *     it. A shrink returns the tail to the free index. A grow absorbs a
+ *     following free block; failing that, a block that ends the heap is
+ *     extended by just the missing bytes. Otherwise the payload has to
+ *     move: into a free block elsewhere if one fits, else down into a
+ *     preceding free block (memmove), and only as a last resort into a
+ *     block from a heap extension.
  */
 void *mm_realloc(void *ptr, size_t size)
 {
@@ -177,78 +695,135 @@ void *mm_realloc(void *ptr, size_t size)
     // 새로운 블록을 저장할 포인터 선언
     void *new_ptr;
 
-    // 새롭게 필요한 크기를 계산 (요청 크기 + 헤더/풋터 크기)
-    size_t new_size = size + DOUBLE_WORD_SIZE;
+    STAT_INC(reallocs);
+    STAT_INC(size_hist[STAT_BUCKET(size)]);
+    CALL_CHECK(old_ptr, "mm_realloc");
 
-    // 기존 블록의 크기를 가져옴
-    size_t old_size = GET_BLOCK_SIZE(HEADER_PTR(old_ptr));
-
-    // 현재 블록을 포함한 누적 크기 초기화
-    size_t total_size = old_size;
-
-    // 블록 병합을 위한 플래그
-    int found_sufficient_space = 0;
-    int wrap_around_flag = 0;
-
-    // 1. 요청 크기가 기존 블록 크기 이하라면, 기존 블록을 그대로 사용
-    if (new_size <= old_size) 
+    // mapping 블록은 mremap으로 크기만 바꿈
+    if (IS_MMAPPED_PTR(old_ptr))
     {
-        return old_ptr;
+        return mmap_realloc(old_ptr, size);
     }
 
-    // 2. 병합 가능한 연속된 free 블록을 검색
-    void *temp_ptr = old_ptr;
-    while (GET_ALLOC_STATUS(HEADER_PTR(NEXT_BLOCK_PTR(temp_ptr))) == 0) 
+    // slab 슬롯: 클래스 크기 안이면 그대로, 아니면 새 블록으로 옮김
+    if (IS_SLAB_PTR(old_ptr))
     {
-        // 다음 블록의 크기를 누적
-        total_size += GET_BLOCK_SIZE(HEADER_PTR(NEXT_BLOCK_PTR(temp_ptr)));
-
-        // 탐색 중 `next_p`를 초과했는지 확인
-        if (temp_ptr == next_p)
+        size_t slot_size = slab_class_size[SLAB_RUN_PTR(old_ptr)->class_idx];
+        if (size <= slot_size)
+        {
+            return old_ptr;
+        }
+        if ((new_ptr = mm_malloc(size)) == NULL)
         {
-            wrap_around_flag = 1;
+            return NULL;
         }
+        memcpy(new_ptr, old_ptr, slot_size);
+        COUNT_COPY(slot_size);
+        STAT_INC(realloc_copies);
+        mm_free(old_ptr);
+        return new_ptr;
+    }
 
-        // 누적 크기가 요청 크기를 충족하면 탐색 종료
-        if (new_size <= total_size) 
+    // 힙 예약 범위를 넘는 크기는 블록 크기 계산이 넘치고 제자리에서 늘릴 수도 없으므로 mapping으로만 옮김
+    // (mm_malloc이 실패하면 기존 블록은 그대로 둠)
+    if (size > heap_limit - 4 * DOUBLE_WORD_SIZE)
+    {
+        if ((new_ptr = mm_malloc(size)) == NULL)
         {
-            found_sufficient_space = 1;
-            break;
+            return NULL;
         }
+        size_t old_payload = GET_BLOCK_SIZE(HEADER_PTR(old_ptr)) - WORD_SIZE;
+        memcpy(new_ptr, old_ptr, old_payload);
+        COUNT_COPY(old_payload);
+        STAT_INC(realloc_copies);
+        mm_free(old_ptr);
+        return new_ptr;
+    }
+
+    // 새롭게 필요한 블록 크기를 계산 (arena_malloc과 같은 규칙)
+    size_t new_size = (size <= MIN_BLOCK_SIZE - WORD_SIZE) ? MIN_BLOCK_SIZE : ALIGN(size + WORD_SIZE);
 
-        // 다음 블록으로 이동
-        temp_ptr = NEXT_BLOCK_PTR(temp_ptr);
+    // 기존 블록의 크기를 가져옴
+    size_t old_size = GET_BLOCK_SIZE(HEADER_PTR(old_ptr));
+
+    // 이웃 블록은 소유 arena의 잠금 아래에서만 봄
+    arena_t *ar = arena_of(old_ptr);
+    ARENA_LOCK(ar);
+
+    // 1. 요청 크기가 기존 블록 크기 이하라면, 남는 뒷부분만 free 블록으로 떼어냄
+    if (new_size <= old_size)
+    {
+        tail_splitter(ar, old_ptr, new_size);
+        ARENA_UNLOCK(ar);
+        STAT_INC(realloc_shrinks);
+        return old_ptr;
+    }
+
+    // 2. 뒤따르는 free 블록을 합쳐서 충분한 크기가 되는지 확인
+    // (병합이 항상 즉시 일어나므로 연속된 free 블록은 최대 하나)
+    if (new_size <= old_size + next_free_size(old_ptr))
+    {
+        next_absorber(ar, old_ptr, new_size);
+        ARENA_UNLOCK(ar);
+        STAT_INC(realloc_grows);
+        return old_ptr;
     }
 
-    // 3. 충분한 크기의 연속된 블록을 찾았을 경우
-    if (found_sufficient_space) 
+    // 3. 힙 끝의 블록이면 뒤에 모자란 만큼만 힙을 늘림 (heap_extender가 끝의 free 블록을 감안)
+    // (다른 arena가 먼저 늘렸다면 heap_extender가 새 segment를 만들므로 다시 확인)
+    void *last_ptr = next_free_size(old_ptr) ? NEXT_BLOCK_PTR(old_ptr) : old_ptr;
+    if (NEXT_BLOCK_PTR(last_ptr) == ar->heap_end &&
+        heap_extender(ar, (new_size - old_size) / WORD_SIZE) != NULL &&
+        new_size <= old_size + next_free_size(old_ptr))
     {
-        // 기존 블록을 확장하여 헤더와 풋터를 업데이트
-        PUT_WORD(HEADER_PTR(old_ptr), PACK_BLOCK(total_size, 1)); // 헤더 갱신
-        PUT_WORD(FOOTER_PTR(old_ptr), PACK_BLOCK(total_size, 1)); // 풋터 갱신
+        next_absorber(ar, old_ptr, new_size);
+        ARENA_UNLOCK(ar);
+        STAT_INC(realloc_grows);
+        return old_ptr;
+    }
 
-        // 탐색 중 `next_p`를 초과했으면 `next_p`를 갱신
-        if (wrap_around_flag) 
+    // 4. 다른 곳에 맞는 free 블록이 없고 앞의 free 블록까지 합치면 충분한 경우, payload를 앞으로 옮김
+    // (어차피 복사가 필요하므로 다른 free 블록이 있으면 그쪽을 쓰는 편이 힙 끝을 막지 않음, 영역이 겹치므로 memmove)
+    if (!GET_PREV_ALLOC(HEADER_PTR(old_ptr)) && fit_finder(ar, new_size) == NULL)
+    {
+        char *prev_ptr = PREVIOUS_BLOCK_PTR(old_ptr);
+        size_t total_size = GET_BLOCK_SIZE(HEADER_PTR(prev_ptr)) + old_size + next_free_size(old_ptr);
+        if (new_size <= total_size)
         {
-            next_p = old_ptr;
+            void *next_ptr = NEXT_BLOCK_PTR(old_ptr);
+            remove_free_block(ar, prev_ptr);
+            if (!GET_ALLOC_STATUS(HEADER_PTR(next_ptr)))
+            {
+                remove_free_block(ar, next_ptr);
+            }
+            memmove(prev_ptr, old_ptr, old_size - WORD_SIZE);
+            COUNT_COPY(old_size - WORD_SIZE);
+
+            // free 블록의 이전 블록은 항상 할당 상태
+            PUT_WORD(HEADER_PTR(prev_ptr), PACK_BLOCK(total_size, 1) | PREV_ALLOC);
+            SET_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(prev_ptr)));
+            ROVER_MERGE(ar, prev_ptr);
+            tail_splitter(ar, prev_ptr, new_size);
+            ARENA_UNLOCK(ar);
+            STAT_INC(realloc_slides);
+            return prev_ptr;
         }
-
-        // 기존 블록 확장 후 반환
-        return old_ptr;
     }
+    ARENA_UNLOCK(ar);
 
-    // 4. 충분한 크기의 블록을 찾지 못한 경우
-    // 새 블록을 할당
-    new_ptr = mm_malloc(new_size);
+    // 5. 제자리에서 늘릴 수 없는 경우 새 블록을 할당
+    new_ptr = mm_malloc(size);
 
     // 할당 실패 시 NULL 반환
-    if (new_ptr == NULL) 
+    if (new_ptr == NULL)
     {
         return NULL;
     }
 
-    // 5. 기존 블록의 데이터를 새 블록으로 복사
-    memcpy(new_ptr, old_ptr, old_size);
+    // 기존 블록의 데이터를 새 블록으로 복사 (payload 부분만)
+    memcpy(new_ptr, old_ptr, old_size - WORD_SIZE);
+    COUNT_COPY(old_size - WORD_SIZE);
+    STAT_INC(realloc_copies);
 
     // 기존 블록을 free
     mm_free(old_ptr);
@@ -258,176 +833,3223 @@ void *mm_realloc(void *ptr, size_t size)
 }
 
 
-static void *heap_extender(size_t words)
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes into out[] and
+ *     return how many were allocated (fewer than n only when memory
+ *     runs out). Heap blocks are carved back to back out of as few
+ *     fits as possible: first a free block holding all that is left,
+ *     else any free block holding at least one (so holes still get
+ *     used), else a heap extension for the rest. Each fit costs one
+ *     search and one placement plus a pass writing the headers.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
 {
-    // 확장할 힙 영역의 시작 포인터와 크기를 선언
+    arena_t *ar;
+    size_t asize, want, i;
     char *bp;
-    size_t size;
 
-    // 요청된 word 수가 짝수인지 확인하여 size 계산
-    if (words % 2 == 0) 
-    {
-        size = WORD_SIZE * words; // 짝수일 경우 그대로 계산
-    } else 
+    if (size == 0 || n == 0)
     {
-        size = WORD_SIZE * (words + 1); // 홀수일 경우 한 word 추가
+        return 0;
     }
 
-    // 힙을 요청된 크기만큼 확장
-    bp = mem_sbrk(size);
+    // 큰 요청은 하나씩 별도 mapping으로
+    if (mmap_threshold > 0 && size >= mmap_threshold)
+    {
+        for (i = 0; i < n && (out[i] = mm_malloc(size)) != NULL; i++)
+            ;
+        return i;
+    }
 
-    // 힙 확장이 실패한 경우 NULL 반환
-    if (bp == (void *)-1) 
+    // arena_malloc과 같은 규칙으로 블록 크기를 계산
+    asize = (size <= MIN_BLOCK_SIZE - WORD_SIZE) ? MIN_BLOCK_SIZE : ALIGN(size + WORD_SIZE);
+    if (asize >= heap_limit)
     {
-        return NULL;
+        return 0;
     }
+    STAT_ADD(mallocs, n);
+    STAT_ADD(size_hist[STAT_BUCKET(size)], n);
 
-    // 새로 확장된 블록의 헤더와 풋터를 설정 (free 상태)
-    PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0));  // 헤더 설정
-    PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));  // 풋터 설정
+    ar = arena_current();
+    ARENA_LOCK(ar);
 
-    // 새로운 에필로그 헤더를 생성 (할당된 상태, 크기 0)
-    PUT_WORD(HEADER_PTR(NEXT_BLOCK_PTR(bp)), PACK_BLOCK(0, 1));
+    // slab이 켜진 작은 요청은 슬롯을 하나씩 (슬롯 할당은 이미 O(1))
+    if (size <= SLAB_MAX_SIZE && ar->small_live >= SLAB_WARMUP)
+    {
+        for (i = 0; i < n && (out[i] = arena_malloc(ar, size)) != NULL; i++)
+            ;
+        ARENA_UNLOCK(ar);
+        return i;
+    }
 
-    // 새로 확장된 블록을 병합하고 병합된 블록의 시작 포인터를 반환
-    return coalescer(bp);
+    for (i = 0; i < n; )
+    {
+        // 남은 블록을 모두 담는 블록, 없으면 하나라도 담는 블록, 없으면 힙 확장
+        want = MIN_VALUE(n - i, heap_limit / asize) * asize;
+        if ((bp = fit_finder(ar, want)) == NULL &&
+            (bp = fit_finder(ar, asize)) == NULL &&
+            (bp = heap_extender(ar, want / WORD_SIZE)) == NULL)
+        {
+            break;
+        }
+        i += batch_carver(ar, bp, asize, MIN_VALUE(n - i, GET_BLOCK_SIZE(HEADER_PTR(bp)) / asize), out + i);
+    }
+    if (size <= SLAB_MAX_SIZE)
+    {
+        ar->small_live += i;
+    }
+    ARENA_UNLOCK(ar);
+    return i;
 }
 
-
-static void *coalescer(void *bp)
+/*
+ * batch_carver - Allocate count blocks of asize bytes back to back from
+ *     the free block bp and store them in out[]. The last block keeps
+ *     whatever placer did not split off. Returns count.
+ */
+static size_t batch_carver(arena_t *ar, char *bp, size_t asize, size_t count, void **out)
 {
-    // 이전 블록과 다음 블록의 할당 상태를 확인
-    size_t prev_alloc = GET_ALLOC_STATUS(FOOTER_PTR(PREVIOUS_BLOCK_PTR(bp)));
-    size_t next_alloc = GET_ALLOC_STATUS(HEADER_PTR(NEXT_BLOCK_PTR(bp)));
+    size_t total, i;
 
-    // 현재 블록의 크기를 가져옴
-    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    placer(ar, bp, asize * count);
 
-    // Case 1: 이전 블록과 다음 블록 모두 할당된 상태
-    if (prev_alloc && next_alloc) 
+    // 배치된 블록을 count개로 나눔 (첫 블록은 이전 블록 비트를 유지)
+    total = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    for (i = 0; i < count; i++)
     {
-        next_p = bp;  // `next_p`를 현재 블록으로 설정
-        return bp;    // 병합할 필요가 없으므로 그대로 반환
+        size_t block_size = (i == count - 1) ? total - (count - 1) * asize : asize;
+        size_t prev_alloc = (i == 0) ? GET_PREV_ALLOC(HEADER_PTR(bp)) : PREV_ALLOC;
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(block_size, 1) | prev_alloc);
+        out[i] = bp;
+        bp += asize;
     }
+    return count;
+}
 
-    // Case 2: 이전 블록은 할당되고 다음 블록은 free 상태
-    if (prev_alloc && !next_alloc) 
+
+/*
+ * mm_free_sized - Free ptr, which was allocated with size bytes (or is
+ *     known to have at least size usable bytes). A size above
+ *     SLAB_MAX_SIZE rules out a slab slot without the page map lookup,
+ *     and in the thread-safe build the thread cache class follows from
+ *     size without reading the block or run header. The header itself
+ *     is still read when the block goes back to the heap, since only it
+ *     holds the tag bits and any unsplit slack.
+ */
+void mm_free_sized(void *ptr, size_t size)
+{
+    arena_t *ar;
+
+    if (ptr == NULL)
     {
-        size += GET_BLOCK_SIZE(HEADER_PTR(NEXT_BLOCK_PTR(bp))); // 다음 블록 크기 추가
-        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0));         // 헤더 갱신
-        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));         // 풋터 갱신
+        return;
     }
+    STAT_INC(frees);
+    CALL_CHECK(ptr, "mm_free_sized");
 
-    // Case 3: 이전 블록은 free 상태이고 다음 블록은 할당된 상태
-    else if (!prev_alloc && next_alloc) 
+    // mapping 블록은 잠금 없이 바로 해제
+    if (IS_MMAPPED_PTR(ptr))
     {
-        size += GET_BLOCK_SIZE(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))); // 이전 블록 크기 추가
-        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));             // 풋터 갱신
-        PUT_WORD(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp)), PACK_BLOCK(size, 0)); // 이전 블록 헤더 갱신
-        bp = PREVIOUS_BLOCK_PTR(bp);                               // 블록 포인터를 이전 블록으로 이동
+        mmap_free(ptr);
+        return;
     }
 
-    // Case 4: 이전 블록과 다음 블록 모두 free 상태
-    else 
+    // 작은 요청이었으면 slab 슬롯일 수 있으므로 보통 경로로
+    if (size <= SLAB_MAX_SIZE)
     {
-        size += GET_BLOCK_SIZE(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))) +
-                GET_BLOCK_SIZE(FOOTER_PTR(NEXT_BLOCK_PTR(bp))); // 이전 및 다음 블록 크기 추가
-        PUT_WORD(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp)), PACK_BLOCK(size, 0)); // 이전 블록 헤더 갱신
-        PUT_WORD(FOOTER_PTR(NEXT_BLOCK_PTR(bp)), PACK_BLOCK(size, 0));     // 다음 블록 풋터 갱신
-        bp = PREVIOUS_BLOCK_PTR(bp);                                       // 블록 포인터를 이전 블록으로 이동
+#ifdef MM_THREADS
+        // slab 슬롯은 요청 크기의 클래스, 힙 블록은 요청 크기로 보장되는 payload를 넘지 않는 가장 큰 클래스
+        int class_idx;
+        if (IS_SLAB_PTR(ptr))
+        {
+            class_idx = slab_class(size);
+        }
+        else
+        {
+            size_t usable = ((size <= MIN_BLOCK_SIZE - WORD_SIZE) ? MIN_BLOCK_SIZE : ALIGN(size + WORD_SIZE)) - WORD_SIZE;
+            class_idx = (usable >= SLAB_MAX_SIZE) ? SLAB_CLASS_COUNT - 1 : slab_class(usable + 1) - 1;
+        }
+        if (class_idx >= 0)
+        {
+            if (tcache.generation != heap_generation)
+            {
+                tcache_reset();
+            }
+            if (tcache.counts[class_idx] < TCACHE_COUNT)
+            {
+                *(void **)ptr = tcache.bins[class_idx];
+                tcache.bins[class_idx] = ptr;
+                tcache.counts[class_idx]++;
+                return;
+            }
+        }
+#endif
+        ar = arena_of(ptr);
+        ARENA_LOCK(ar);
+        arena_free(ar, ptr);
+        ARENA_UNLOCK(ar);
+        return;
     }
 
-    // `next_p`를 병합된 블록의 시작 포인터로 업데이트
-    next_p = bp;
-
-    // 병합된 블록의 시작 포인터 반환
-    return bp;
+    // slab 한도를 넘는 요청은 항상 힙 블록
+    ar = arena_of(ptr);
+    ARENA_LOCK(ar);
+    run_releaser(ar, ptr, GET_BLOCK_SIZE(HEADER_PTR(ptr)));
+    ARENA_UNLOCK(ar);
 }
 
 
-static void *fit_finder(size_t size)
+/*
+ * mm_free_batch - Free the n pointers in ptrs, which is sorted by
+ *     address in place. Blocks that lie back to back in the heap are
+ *     released as one run: one header and footer for the whole run and
+ *     one coalescer call, instead of one merge per block. NULL entries
+ *     are skipped.
+ */
+void mm_free_batch(void **ptrs, size_t n)
 {
-    // 힙을 순회하기 위한 포인터
-    void *bp;
+    arena_t *ar = NULL;
+    arena_t *owner;
+    char *bp, *end;
+    size_t i, j, size;
 
-    // 적합한 블록을 찾았을 경우 해당 블록의 포인터를 저장할 변수
-    void *next_fit_block = NULL;
+    STAT_ADD(frees, n);
 
-    // next_p가 NULL일 경우 힙의 시작 지점으로 초기화
-    if (next_p == NULL) 
-    {
-        next_p = heap_p;
-    }
+    // 주소 순으로 정렬하면 힙에서 붙어있는 블록이 배열에서도 연달아 옴
+    qsort(ptrs, n, sizeof(void *), address_compare);
 
-    // 힙의 끝까지 순회하며 적합한 free 블록을 찾음
-    bp = next_p;
-    while (GET_BLOCK_SIZE(HEADER_PTR(bp)) > 0) 
+    for (i = 0; i < n; i = j)
     {
-        // 현재 블록이 할당된 상태면 다음 블록으로 이동
-        if (GET_ALLOC_STATUS(HEADER_PTR(bp))) 
+        bp = ptrs[i];
+        j = i + 1;
+        if (bp == NULL)
+        {
+            continue;
+        }
+        if (IS_MMAPPED_PTR(bp))
         {
-            bp = NEXT_BLOCK_PTR(bp);
+            mmap_free(bp);
             continue;
         }
 
-        // 요청된 크기보다 크거나 같은 free 블록을 찾았을 경우
-        if (size <= GET_BLOCK_SIZE(HEADER_PTR(bp))) 
+        // 소유 arena가 바뀔 때만 잠금을 바꿈
+        owner = arena_of(bp);
+        if (owner != ar)
+        {
+            if (ar != NULL)
+            {
+                ARENA_UNLOCK(ar);
+            }
+            ar = owner;
+            ARENA_LOCK(ar);
+        }
+        if (IS_SLAB_PTR(bp))
         {
-            next_fit_block = bp; // 해당 블록을 적합한 블록으로 설정
-            next_p = bp;         // next_p를 현재 블록으로 갱신
-            break;               // 탐색 종료
+            slab_free(ar, bp);
+            continue;
         }
 
-        // 다음 블록으로 이동
-        bp = NEXT_BLOCK_PTR(bp);
+        // 바로 뒤에 붙어있는 블록을 모두 모아 하나의 run으로 해제
+        end = bp;
+        for (;;)
+        {
+            size = GET_BLOCK_SIZE(HEADER_PTR(end));
+            if (size <= SLAB_BLOCK_LIMIT && ar->small_live > 0)
+            {
+                ar->small_live--;
+            }
+            end += size;
+            if (j == n || ptrs[j] != end)
+            {
+                break;
+            }
+            j++;
+        }
+        run_releaser(ar, bp, end - bp);
+    }
+    if (ar != NULL)
+    {
+        ARENA_UNLOCK(ar);
     }
-
-    // 적합한 블록의 포인터를 반환 (없으면 NULL 반환)
-    return next_fit_block;
 }
 
-static void placer(void *bp, size_t size)
+
+/*
+ * mm_calloc - Allocate a zeroed array of nmemb elements of size bytes.
+ *     Memory that memlib has never handed out is known to be zero, so
+ *     when the allocation extended the heap only the part of the block
+ *     below the mark heap_extender read under the sbrk lock is cleared,
+ *     plus the free-block links and footer that the allocator itself
+ *     may have written into fresh memory. Mapped blocks are always fresh.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
 {
-    // 현재 블록의 크기를 가져옴
-    size_t current_size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    arena_t *ar;
+    char *bp;
+    char *zero_lo;
+    size_t total;
+    size_t dirty;
 
-    // Case 1: 블록을 분할할 수 있을 만큼 충분히 큰 경우
-    if ((current_size - size) >= (2 * DOUBLE_WORD_SIZE)) 
+    // 곱이 넘치면 실패
+    if (size != 0 && nmemb > (size_t)-1 / size)
+    {
+        return NULL;
+    }
+    total = nmemb * size;
+    if (total == 0)
     {
-        // 현재 블록을 요청된 크기로 설정 (헤더와 풋터 갱신)
-        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 1));  // 헤더 설정
-        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 1));  // 풋터 설정
+        return NULL;
+    }
+    STAT_INC(mallocs);
+    STAT_INC(size_hist[STAT_BUCKET(total)]);
 
-        // 분할 후 남은 공간을 새로운 free 블록으로 설정
-        void *next_bp = NEXT_BLOCK_PTR(bp);             // 다음 블록의 시작 주소 계산
-        PUT_WORD(HEADER_PTR(next_bp), PACK_BLOCK(current_size - size, 0)); // 헤더 갱신
-        PUT_WORD(FOOTER_PTR(next_bp), PACK_BLOCK(current_size - size, 0)); // 풋터 갱신
+    // mapping은 새로 받은 페이지라 항상 0
+    if (mmap_threshold > 0 && total >= mmap_threshold && (bp = mmap_alloc(total)) != NULL)
+    {
+        return bp;
+    }
+
+    // 0인 영역의 표시는 이 할당이 힙을 확장했을 때만 heap_extender가 남김
+    // (전역 표시를 미리 읽어 두면 그 사이 다른 arena가 쓰고 줄인 영역을 0으로 착각할 수 있음)
+    ar = arena_current();
+    ARENA_LOCK(ar);
+    ar->zero_lo = NULL;
+    bp = arena_malloc(ar, total);
+    zero_lo = ar->zero_lo;
+    ARENA_UNLOCK(ar);
+    if (bp == NULL)
+    {
+        return NULL;
+    }
 
-        // `next_p`를 새로 생성된 free 블록으로 업데이트
-        next_p = next_bp;
+    // slab 슬롯은 재사용된 메모리이므로 전부 지움
+    if (IS_SLAB_PTR(bp))
+    {
+        memset(bp, 0, total);
+        return bp;
+    }
 
-    // Case 2: 블록을 분할할 수 없을 만큼 작은 경우
-    } else 
+    // 확장이 없었으면 전부, 있었으면 0인 영역 아래 부분과 free 블록으로서 쓰인 링크 워드(앞)와 풋터(뒤)만 지움
+    dirty = (zero_lo == NULL) ? total : (bp < zero_lo) ? (size_t)(zero_lo - bp) : 0;
+    dirty = MIN_VALUE(MAX_VALUE(dirty, 3 * WORD_SIZE), total);
+    memset(bp, 0, dirty);
+    if (dirty < total)
+    {
+        char *footer = (char *)bp + GET_BLOCK_SIZE(HEADER_PTR(bp)) - DOUBLE_WORD_SIZE;
+        if (footer < bp + total)
+        {
+            PUT_WORD(footer, 0);
+        }
+    }
+    return bp;
+}
+
+
+/*
+ * mm_memalign - Allocate size bytes whose payload address is a multiple
+ *     of alignment, which must be a power of two. The slack in front of
+ *     the aligned payload becomes a free block instead of being wasted.
+ *     Aligned blocks always come from the heap, even above the mmap
+ *     threshold.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    arena_t *ar;
+    size_t asize;
+    void *bp;
+
+    // 2의 거듭제곱이 아니거나 힙에 들어갈 수 없으면 실패
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || size == 0 || size >= heap_limit || alignment >= heap_limit)
+    {
+        return NULL;
+    }
+
+    // 기본 정렬이면 보통 할당과 같음
+    if (alignment <= ALIGNMENT)
     {
-        // 현재 블록 전체를 할당 상태로 설정 (헤더와 풋터 갱신)
-        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(current_size, 1)); // 헤더 설정
-        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(current_size, 1)); // 풋터 설정
+        return mm_malloc(size);
+    }
+    STAT_INC(mallocs);
+    STAT_INC(size_hist[STAT_BUCKET(size)]);
+
+    // arena_malloc과 같은 규칙으로 블록 크기를 계산
+    asize = (size <= MIN_BLOCK_SIZE - WORD_SIZE) ? MIN_BLOCK_SIZE : ALIGN(size + WORD_SIZE);
+
+    ar = arena_current();
+    ARENA_LOCK(ar);
+    bp = aligned_block(ar, alignment, asize);
+    ARENA_UNLOCK(ar);
+    return bp;
+}
+
+/*
+ * mm_aligned_alloc - C11 aligned_alloc on top of mm_memalign.
+ */
+void *mm_aligned_alloc(size_t alignment, size_t size)
+{
+    return mm_memalign(alignment, size);
+}
+
 
-        // `next_p`를 현재 블록으로 업데이트
-        next_p = bp;
+/*
+ * mm_malloc_usable_size - Return the number of payload bytes of the
+ *     allocated block ptr, which may exceed the requested size by the
+ *     rounding slack. Returns 0 for NULL.
+ */
+size_t mm_malloc_usable_size(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return 0;
+    }
+    if (IS_MMAPPED_PTR(ptr))
+    {
+        return MMAP_LENGTH(ptr) - MMAP_OVERHEAD;
+    }
+    if (IS_SLAB_PTR(ptr))
+    {
+        return slab_class_size[SLAB_RUN_PTR(ptr)->class_idx];
     }
+
+    // 할당 블록은 헤더만 있으므로 나머지가 모두 payload
+    return GET_BLOCK_SIZE(HEADER_PTR(ptr)) - WORD_SIZE;
 }
 
 
+/*
+ * mm_arena_create - Create a region arena whose first chunk is
+ *     chunk_size bytes (0 picks REGION_CHUNK_SIZE). The arena header
+ *     lives at the start of that chunk. Returns NULL when out of memory.
+ *     An arena belongs to one thread at a time; only its chunks come
+ *     from the shared heap.
+ */
+mm_arena_t *mm_arena_create(size_t chunk_size)
+{
+    mm_arena_t *arena;
 
+    if (chunk_size == 0)
+    {
+        chunk_size = REGION_CHUNK_SIZE;
+    }
+    chunk_size = MAX_VALUE(chunk_size, 4 * REGION_FIRST);
 
+    // 블록 크기가 정확히 chunk_size가 되도록 헤더 워드만큼 덜 요청
+    if ((arena = mm_malloc(chunk_size - WORD_SIZE)) == NULL)
+    {
+        return NULL;
+    }
+    arena->chunks = NULL;
+    mm_arena_reset(arena);
+    return arena;
+}
 
 
+/*
+ * mm_arena_alloc - Allocate size bytes from the arena by bumping a
+ *     pointer in its current chunk. Objects carry no header and cannot
+ *     be freed one by one; they all go away with mm_arena_reset or
+ *     mm_arena_destroy.
+ */
+void *mm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+    char *bp = arena->cur;
 
+    // 예외 처리: 크기가 0이거나 정렬 올림에서 넘치면 NULL 반환
+    if (size == 0 || size > (size_t)-1 - REGION_HEADER - ALIGNMENT)
+    {
+        return NULL;
+    }
+    size = ALIGN(size);
 
+    if (size <= (size_t)(arena->end - bp))
+    {
+        arena->cur = bp + size;
+        return bp;
+    }
+    return region_refiller(arena, size);
+}
 
 
+/*
+ * mm_arena_reset - Free every object of the arena at once. Only the
+ *     first chunk is kept; later chunks and the blocks of large objects
+ *     go back to the heap, so the cost depends on the number of chunks,
+ *     not on the number of objects.
+ */
+void mm_arena_reset(mm_arena_t *arena)
+{
+    region_chunk_t *chunk, *next;
 
+    for (chunk = arena->chunks; chunk != NULL; chunk = next)
+    {
+        next = chunk->next;
+        mm_free(chunk);
+    }
 
+    // 첫 chunk만 남기고 chunk 크기도 처음부터 다시 늘림
+    arena->chunks = NULL;
+    arena->cur = (char *)arena + REGION_FIRST;
+    arena->end = (char *)arena + mm_malloc_usable_size(arena);
+    arena->chunk_size = (size_t)(arena->end - (char *)arena) + WORD_SIZE;
+}
 
 
+/*
+ * mm_arena_destroy - Free every object of the arena and the arena
+ *     itself.
+ */
+void mm_arena_destroy(mm_arena_t *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    mm_arena_reset(arena);
+    mm_free(arena);
+}
+
+
+/*
+ * mm_pool_create - Create a pool of obj_size-byte objects. Objects are
+ *     taken from and given back to a per-thread magazine; full
+ *     magazines move between threads through a lock-free stack, so an
+ *     object may be freed by any thread. Returns NULL if obj_size is 0
+ *     or too large, or if all POOL_COUNT pools are in use.
+ */
+mm_pool_t *mm_pool_create(size_t obj_size)
+{
+    mm_pool_t *pool;
+    int i, expected;
+
+    if (obj_size == 0 || obj_size > heap_limit / (2 * POOL_MAGAZINE_SIZE))
+    {
+        return NULL;
+    }
+
+    // 비어있는 칸을 CAS로 차지
+    for (i = 0; i < POOL_COUNT; i++)
+    {
+        pool = &pools[i];
+        expected = 0;
+        if (__atomic_compare_exchange_n(&pool->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            pool->depot = DEPOT_HEAD(0, 0);
+            pool->obj_size = MAX_VALUE(ALIGN(obj_size), ALIGN(POOL_MIN_OBJECT));
+            pool->chunks = NULL;
+            pool->cur = NULL;
+            pool->end = NULL;
+#ifdef MM_THREADS
+            pthread_mutex_init(&pool->lock, NULL);
+#endif
+            __atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+            return pool;
+        }
+    }
+    return NULL;
+}
+
+
+/*
+ * mm_pool_alloc - Take an object from the calling thread's magazine,
+ *     reloading it from the depot or a fresh chunk when it is empty.
+ *     Returns NULL when out of memory.
+ */
+void *mm_pool_alloc(mm_pool_t *pool)
+{
+    pool_magazine_t *mag = pool_magazine(pool);
+    char *bp;
+
+    if (mag->count == 0 && magazine_loader(pool, mag) == 0)
+    {
+        return NULL;
+    }
+    bp = mag->head;
+    mag->head = OFFSET_TO_PTR(GET_WORD(bp));
+    mag->count--;
+    return bp;
+}
+
+
+/*
+ * mm_pool_free - Put obj into the calling thread's magazine. A full
+ *     magazine is pushed onto the depot as one chain (a single CAS)
+ *     and a new one is started.
+ */
+void mm_pool_free(mm_pool_t *pool, void *obj)
+{
+    pool_magazine_t *mag;
+
+    if (obj == NULL)
+    {
+        return;
+    }
+    mag = pool_magazine(pool);
+    if (mag->count == POOL_MAGAZINE_SIZE)
+    {
+        depot_push(pool, mag->head, mag->count);
+        mag->head = NULL;
+        mag->count = 0;
+    }
+    PUT_WORD(obj, PTR_TO_OFFSET(mag->head));
+    mag->head = obj;
+    mag->count++;
+}
+
+
+/*
+ * mm_pool_destroy - Return all of the pool's chunks to the heap. No
+ *     thread may use the pool or its objects any more; their magazines
+ *     see the new generation and drop what they still hold.
+ */
+void mm_pool_destroy(mm_pool_t *pool)
+{
+    char *chunk, *next;
+
+    if (pool == NULL)
+    {
+        return;
+    }
+    for (chunk = pool->chunks; chunk != NULL; chunk = next)
+    {
+        next = *(char **)chunk;
+        mm_free(chunk);
+    }
+    pool->chunks = NULL;
+#ifdef MM_THREADS
+    pthread_mutex_destroy(&pool->lock);
+#endif
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&pool->in_use, 0, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * mm_halloc - Allocate a movable block of size bytes and return its
+ *     handle, or 0 when out of memory. Handle blocks always live in the
+ *     heap (never in a slab run or a mapping) and end with a word
+ *     naming their handle, so the compactor can update the table.
+ */
+mm_handle_t mm_halloc(size_t size)
+{
+    arena_t *ar;
+    unsigned int handle;
+    size_t asize;
+    char *bp;
+
+    if (size == 0 || size > heap_limit)
+    {
+        return 0;
+    }
+    asize = HANDLE_ASIZE(size);
+
+    HANDLE_LOCK();
+    if ((handle = handle_reserver()) == 0)
+    {
+        HANDLE_UNLOCK();
+        return 0;
+    }
+
+    ar = arena_current();
+    ARENA_LOCK(ar);
+    if ((bp = fit_finder(ar, asize)) == NULL)
+    {
+        bp = heap_extender(ar, asize / WORD_SIZE);
+    }
+    if (bp != NULL)
+    {
+        placer(ar, bp, asize);
+        PUT_WORD(HEADER_PTR(bp), GET_WORD(HEADER_PTR(bp)) | HANDLE_BLOCK);
+        PUT_WORD(HANDLE_INDEX(bp), handle);
+    }
+    ARENA_UNLOCK(ar);
+
+    if (bp == NULL)
+    {
+        // 받은 칸을 빈 칸 리스트에 돌려줌
+        handle_table[handle - 1].next = handle_free;
+        handle_free = handle;
+        HANDLE_UNLOCK();
+        return 0;
+    }
+    handle_table[handle - 1].offset = PTR_TO_OFFSET(bp);
+    handle_table[handle - 1].pins = 0;
+    HANDLE_UNLOCK();
+    return handle;
+}
+
+
+/*
+ * mm_hrealloc - Resize the handle's block to size bytes, keeping the
+ *     handle. Like mm_realloc it shrinks in place, grows into a free
+ *     successor or the heap top when it can, and otherwise moves the
+ *     payload to a new block, pinned or not, so addresses from mm_hlock
+ *     must be fetched again. Returns 0 on success and -1 on failure,
+ *     which leaves the block as it was.
+ */
+int mm_hrealloc(mm_handle_t handle, size_t size)
+{
+    arena_t *ar;
+    size_t asize, old_size;
+    char *bp, *new_bp;
+
+    HANDLE_LOCK();
+    if (size == 0 || size > heap_limit || handle == 0 || handle > handle_count ||
+        handle_table[handle - 1].offset == 0)
+    {
+        HANDLE_UNLOCK();
+        return -1;
+    }
+    bp = OFFSET_TO_PTR(handle_table[handle - 1].offset);
+    asize = HANDLE_ASIZE(size);
+    old_size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+
+    ar = arena_of(bp);
+    ARENA_LOCK(ar);
+
+    // 제자리에서 줄이거나 뒤의 free 블록, 힙 끝을 흡수 (mm_realloc의 1~3번과 같음)
+    if (asize <= old_size)
+    {
+        tail_splitter(ar, bp, asize);
+        new_bp = bp;
+    }
+    else if (asize <= old_size + next_free_size(bp) ||
+             (NEXT_BLOCK_PTR(next_free_size(bp) ? NEXT_BLOCK_PTR(bp) : bp) == ar->heap_end &&
+              heap_extender(ar, (asize - old_size) / WORD_SIZE) != NULL &&
+              asize <= old_size + next_free_size(bp)))
+    {
+        next_absorber(ar, bp, asize);
+        new_bp = bp;
+    }
+    else
+    {
+        // 새 블록으로 payload를 옮김 (handle 워드는 새로 씀)
+        if ((new_bp = fit_finder(ar, asize)) == NULL)
+        {
+            new_bp = heap_extender(ar, asize / WORD_SIZE);
+        }
+        if (new_bp == NULL)
+        {
+            ARENA_UNLOCK(ar);
+            HANDLE_UNLOCK();
+            return -1;
+        }
+        placer(ar, new_bp, asize);
+        memcpy(new_bp, bp, old_size - DOUBLE_WORD_SIZE);
+        COUNT_COPY(old_size - DOUBLE_WORD_SIZE);
+        run_releaser(ar, bp, old_size);
+    }
+
+    // 헤더를 다시 쓴 경로가 있으므로 표시와 handle 워드를 복원
+    PUT_WORD(HEADER_PTR(new_bp), GET_WORD(HEADER_PTR(new_bp)) | HANDLE_BLOCK);
+    PUT_WORD(HANDLE_INDEX(new_bp), handle);
+    ARENA_UNLOCK(ar);
+
+    handle_table[handle - 1].offset = PTR_TO_OFFSET(new_bp);
+    HANDLE_UNLOCK();
+    return 0;
+}
+
+
+/*
+ * mm_hlock - Pin the handle's block and return its current address,
+ *     which stays valid until the matching mm_hunlock. Locks nest.
+ *     Returns NULL for an invalid handle.
+ */
+void *mm_hlock(mm_handle_t handle)
+{
+    handle_entry_t *entry;
+    char *bp;
+
+    HANDLE_LOCK();
+    if (handle == 0 || handle > handle_count || handle_table[handle - 1].offset == 0)
+    {
+        HANDLE_UNLOCK();
+        return NULL;
+    }
+    entry = &handle_table[handle - 1];
+    entry->pins++;
+    bp = OFFSET_TO_PTR(entry->offset);
+    HANDLE_UNLOCK();
+    return bp;
+}
+
+
+/*
+ * mm_hunlock - Undo one mm_hlock. Once no pins are left, the block may
+ *     be moved by the next mm_compact.
+ */
+void mm_hunlock(mm_handle_t handle)
+{
+    HANDLE_LOCK();
+    if (handle != 0 && handle <= handle_count && handle_table[handle - 1].pins > 0)
+    {
+        handle_table[handle - 1].pins--;
+    }
+    HANDLE_UNLOCK();
+}
+
+
+/*
+ * mm_hfree - Free the handle's block, pinned or not, and retire the
+ *     handle.
+ */
+void mm_hfree(mm_handle_t handle)
+{
+    arena_t *ar;
+    char *bp;
+
+    HANDLE_LOCK();
+    if (handle == 0 || handle > handle_count || handle_table[handle - 1].offset == 0)
+    {
+        HANDLE_UNLOCK();
+        return;
+    }
+    bp = OFFSET_TO_PTR(handle_table[handle - 1].offset);
+
+    // slab이나 작은 객체 수와 상관없는 블록이므로 바로 free 블록으로
+    ar = arena_of(bp);
+    ARENA_LOCK(ar);
+    run_releaser(ar, bp, GET_BLOCK_SIZE(HEADER_PTR(bp)));
+    ARENA_UNLOCK(ar);
+
+    handle_table[handle - 1].offset = 0;
+    handle_table[handle - 1].next = handle_free;
+    handle_free = handle;
+    HANDLE_UNLOCK();
+}
+
+
+/*
+ * mm_compact - Slide every unpinned handle block toward the start of
+ *     its segment, so the free space between them collects into one
+ *     block at the segment end, then trim the heap top. Pinned handle
+ *     blocks and ordinary blocks stay put and split the free space.
+ *     Addresses from mm_hlock are stale for blocks that were unpinned.
+ *     Returns the number of bytes moved.
+ */
+size_t mm_compact(void)
+{
+    arena_t *ar;
+    size_t moved = 0;
+    int count, i;
+
+    HANDLE_LOCK();
+    for (ar = arenas; ar < arenas + ARENA_COUNT; ar++)
+    {
+        ARENA_LOCK(ar);
+        ar->rover = NULL;                                   // 블록이 옮겨지므로 next fit은 처음부터
+#ifdef MM_THREADS
+        count = __atomic_load_n(&segment_count, __ATOMIC_ACQUIRE);
+#else
+        count = segment_count;
+#endif
+        for (i = 0; i < count; i++)
+        {
+            if (segments[i].arena == ar)
+            {
+                moved += segment_slider(ar, segments[i].start + 4 * WORD_SIZE);
+            }
+        }
+        ARENA_UNLOCK(ar);
+    }
+    HANDLE_UNLOCK();
+    return moved;
+}
+
+
+/*
+ * mm_copy_bytes - Return the number of payload bytes mm_realloc has
+ *     copied or moved since mm_init.
+ */
+size_t mm_copy_bytes(void)
+{
+    return copy_bytes;
+}
+
+
+/*
+ * mm_stats - Copy the telemetry gathered since mm_init into *stats.
+ *     Returns -1, with *stats zeroed, if mm.c was built without
+ *     -DMM_STATS.
+ */
+int mm_stats(mm_stats_t *stats)
+{
+#ifdef MM_STATS
+    *stats = telemetry;
+    return 0;
+#else
+    memset(stats, 0, sizeof(*stats));
+    return -1;
+#endif
+}
+
+
+/*
+ * mm_check - Check the heap at the given level (see mm.h) and return 0,
+ *     or print the first problem to stderr and return -1. MM_CHECK_BLOCK
+ *     only looks at the prologue of every segment and the epilogue each
+ *     arena ends in; the other levels walk every block of every segment
+ *     and then every free list and the large block tree of each arena.
+ */
+int mm_check(int level)
+{
+    int i;
+    int result = 0;
+
+    if (level == MM_CHECK_OFF)
+    {
+        return 0;
+    }
+
+    // handle 표를 보므로 arena 잠금보다 먼저 handle 잠금을 잡음
+    HANDLE_LOCK();
+    for (i = 0; i < ARENA_COUNT && result == 0; i++)
+    {
+        ARENA_LOCK(&arenas[i]);
+        result = heap_checker(&arenas[i], level);
+        ARENA_UNLOCK(&arenas[i]);
+    }
+    HANDLE_UNLOCK();
+    return result;
+}
+
+
+/*
+ * mm_fork_lock - Take every lock of the thread-safe build, in the order
+ *     the allocator itself nests them, so that no other thread is inside
+ *     the allocator while the caller forks. Meant as the prepare handler
+ *     of pthread_atfork, with mm_fork_unlock as the parent and child
+ *     handlers (the child's only thread is the one that took the locks).
+ */
+void mm_fork_lock(void)
+{
+#ifdef MM_THREADS
+    int i;
+
+    HANDLE_LOCK();
+    for (i = 0; i < POOL_COUNT; i++)
+    {
+        if (__atomic_load_n(&pools[i].in_use, __ATOMIC_ACQUIRE))
+        {
+            POOL_LOCK(&pools[i]);
+            fork_pools |= 1ULL << i;
+        }
+    }
+    for (i = 0; i < ARENA_COUNT; i++)
+    {
+        ARENA_LOCK(&arenas[i]);
+    }
+    SBRK_LOCK();
+#endif
+}
+
+/*
+ * mm_fork_unlock - Release the locks taken by mm_fork_lock.
+ */
+void mm_fork_unlock(void)
+{
+#ifdef MM_THREADS
+    int i;
+
+    SBRK_UNLOCK();
+    for (i = ARENA_COUNT - 1; i >= 0; i--)
+    {
+        ARENA_UNLOCK(&arenas[i]);
+    }
+    for (i = POOL_COUNT - 1; i >= 0; i--)
+    {
+        if ((fork_pools >> i) & 1)
+        {
+            POOL_UNLOCK(&pools[i]);
+        }
+    }
+    fork_pools = 0;
+    HANDLE_UNLOCK();
+#endif
+}
+
+
+/*
+ * mm_setopt - Set a tunable parameter (see mm.h). Returns 0 on success
+ *     and -1 for an unknown option.
+ */
+int mm_setopt(int option, size_t value)
+{
+    switch (option)
+    {
+    case MM_TRIM_THRESHOLD:
+        trim_threshold = value;
+        return 0;
+    case MM_TOP_PAD:
+        top_pad = ALIGN(value);
+        return 0;
+    case MM_MMAP_THRESHOLD:
+        mmap_threshold = value;
+        return 0;
+    case MM_GROW_POLICY:
+        if (value > MM_GROW_GEOMETRIC)
+        {
+            return -1;
+        }
+        grow_policy = (int)value;
+        return 0;
+    case MM_GROW_CAP:
+        grow_cap = ALIGN(value);
+        return 0;
+    case MM_CHECK_LEVEL:
+        if (value > MM_CHECK_SAMPLED)
+        {
+            return -1;
+        }
+        check_level = (int)value;
+        return 0;
+    case MM_CHECK_INTERVAL:
+        if (value == 0)
+        {
+            return -1;
+        }
+        check_interval = value;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+
+/*
+ * call_checker - Run the checks check_level asks for on a call to mm_*
+ *     that was handed or returned ptr, aborting on the first problem so
+ *     that it is reported next to its cause.
+ */
+static void call_checker(void *ptr, const char *where)
+{
+    size_t calls;
+
+    if (ptr != NULL && block_checker(ptr, where) < 0)
+    {
+        abort();
+    }
+    if (check_level == MM_CHECK_SAMPLED)
+    {
+#ifdef MM_THREADS
+        calls = __atomic_add_fetch(&check_calls, 1, __ATOMIC_RELAXED);
+#else
+        calls = ++check_calls;
+#endif
+        if (calls % check_interval != 0)
+        {
+            return;
+        }
+    }
+    else if (check_level != MM_CHECK_HEAP)
+    {
+        return;
+    }
+    if (mm_check(MM_CHECK_HEAP) < 0)
+    {
+        fprintf(stderr, "mm_check: heap found corrupt in %s\n", where);
+        abort();
+    }
+}
+
+/*
+ * block_checker - O(1) checks of an allocated block: its header, the
+ *     neighbour bits on either side, and for a slab slot the run header
+ *     and the slot's bit. Returns 0, or -1 after printing the problem.
+ */
+static int block_checker(void *ptr, const char *where)
+{
+    arena_t *ar;
+    slab_run_t *run;
+    char *bp = ptr;
+    size_t size, offset;
+    int result = 0;
+
+    if ((uintptr_t)bp & (ALIGNMENT - 1))
+    {
+        return check_failer(where, bp, "misaligned pointer");
+    }
+
+    // mapping 블록은 헤더와 길이만 봄
+    if (IS_MMAPPED_PTR(bp))
+    {
+        if ((GET_WORD(HEADER_PTR(bp)) & (MMAPPED | 0x1)) != (MMAPPED | 0x1) ||
+            MMAP_LENGTH(bp) % page_size != 0)
+        {
+            return check_failer(where, bp, "bad mapped block header");
+        }
+        return 0;
+    }
+    if (bp < heap_base + 4 * WORD_SIZE || bp > (char *)mem_heap_hi())
+    {
+        return check_failer(where, bp, "pointer outside the heap");
+    }
+
+    // 이웃 블록과 run 비트맵은 소유 arena의 잠금 아래에서만 봄
+    ar = arena_of(bp);
+    ARENA_LOCK(ar);
+    if (IS_SLAB_PTR(bp))
+    {
+        run = SLAB_RUN_PTR(bp);
+        offset = bp - (char *)run - SLAB_FIRST_SLOT;
+        if (run->class_idx >= SLAB_CLASS_COUNT)
+        {
+            result = check_failer(where, bp, "bad slab run header");
+        }
+        else if ((char *)run + SLAB_FIRST_SLOT > bp || offset % slab_class_size[run->class_idx] != 0 ||
+                 offset / slab_class_size[run->class_idx] >= SLAB_RUN_SLOTS(slab_class_size[run->class_idx]))
+        {
+            result = check_failer(where, bp, "pointer is not a slab slot");
+        }
+        else
+        {
+            offset /= slab_class_size[run->class_idx];
+            if ((run->bitmap[offset / 32] >> (offset % 32)) & 1)
+            {
+                result = check_failer(where, bp, "slab slot is free");
+            }
+        }
+        ARENA_UNLOCK(ar);
+        return result;
+    }
+
+    // 헤더, 다음 블록의 이전 블록 비트, 이전 블록이 free면 그 풋터와 헤더
+    size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    if (!GET_ALLOC_STATUS(HEADER_PTR(bp)))
+    {
+        result = check_failer(where, bp, "block is not allocated");
+    }
+    else if (size < MIN_BLOCK_SIZE || size % ALIGNMENT != 0 || bp + size > (char *)mem_heap_hi() + 1)
+    {
+        result = check_failer(where, bp, "bad block size");
+    }
+    else if (!GET_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(bp))))
+    {
+        result = check_failer(where, bp, "next block does not see this one allocated");
+    }
+    else if (!GET_PREV_ALLOC(HEADER_PTR(bp)) &&
+             (GET_BLOCK_SIZE(bp - DOUBLE_WORD_SIZE) < MIN_BLOCK_SIZE ||
+              GET_BLOCK_SIZE(bp - DOUBLE_WORD_SIZE) > (size_t)(bp - heap_base) ||
+              GET_WORD(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))) & 0x1 ||
+              GET_BLOCK_SIZE(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))) != GET_BLOCK_SIZE(bp - DOUBLE_WORD_SIZE)))
+    {
+        result = check_failer(where, bp, "free previous block has a bad header or footer");
+    }
+    ARENA_UNLOCK(ar);
+    return result;
+}
+
+/*
+ * heap_checker - Check one arena. Every segment must start with the
+ *     prologue, and the arena must end in an epilogue at heap_end. A
+ *     full walk (level above MM_CHECK_BLOCK) also checks each block's
+ *     size, its previous-allocated bit, the footer of free blocks, that
+ *     no two free blocks touch and that handle blocks and the handle
+ *     table agree; then that every class list and the bitmaps agree,
+ *     every listed block is free and in its class, the large block tree
+ *     is an ordered red-black tree, and the index holds exactly the free
+ *     blocks the walk found.
+ */
+static int heap_checker(arena_t *ar, int level)
+{
+    char *bp, *end, *prev;
+    size_t size;
+    size_t free_blocks = 0;
+    size_t listed = 0;
+    unsigned int hd;
+    int i, fl, sl, prev_alloc;
+
+    for (i = 0; i < segment_count; i++)
+    {
+        if (segments[i].arena != ar)
+        {
+            continue;
+        }
+        bp = segments[i].start;
+        if (GET_WORD(bp + WORD_SIZE) != (PACK_BLOCK(DOUBLE_WORD_SIZE, 1) | PREV_ALLOC) ||
+            GET_WORD(bp + DOUBLE_WORD_SIZE) != PACK_BLOCK(DOUBLE_WORD_SIZE, 1))
+        {
+            return check_failer("mm_check", bp, "bad prologue");
+        }
+        if (level == MM_CHECK_BLOCK)
+        {
+            continue;
+        }
+
+        // segment의 블록을 주소 순으로 훑음 (다음 segment 시작이나 힙 끝을 넘으면 안 됨)
+        end = (i + 1 < segment_count) ? segments[i + 1].start : (char *)mem_heap_hi() + 1;
+        prev_alloc = 1;
+        for (bp += 4 * WORD_SIZE; (size = GET_BLOCK_SIZE(HEADER_PTR(bp))) != 0; bp += size)
+        {
+            if (size < MIN_BLOCK_SIZE || size % ALIGNMENT != 0 || bp + size > end)
+            {
+                return check_failer("mm_check", bp, "bad block size");
+            }
+            if (!GET_PREV_ALLOC(HEADER_PTR(bp)) != !prev_alloc)
+            {
+                return check_failer("mm_check", bp, "previous-allocated bit disagrees with the previous block");
+            }
+            if (!GET_ALLOC_STATUS(HEADER_PTR(bp)))
+            {
+                if (!prev_alloc)
+                {
+                    return check_failer("mm_check", bp, "two adjacent free blocks");
+                }
+                if (GET_WORD(FOOTER_PTR(bp)) != size)
+                {
+                    return check_failer("mm_check", bp, "header and footer disagree");
+                }
+                free_blocks++;
+            }
+            else if (GET_WORD(HEADER_PTR(bp)) & HANDLE_BLOCK)
+            {
+                hd = GET_WORD(HANDLE_INDEX(bp));
+                if (hd == 0 || hd > handle_count || OFFSET_TO_PTR(handle_table[hd - 1].offset) != bp)
+                {
+                    return check_failer("mm_check", bp, "handle block and handle table disagree");
+                }
+            }
+            prev_alloc = GET_ALLOC_STATUS(HEADER_PTR(bp));
+        }
+        if (GET_WORD(HEADER_PTR(bp)) != (PACK_BLOCK(0, 1) | (prev_alloc ? PREV_ALLOC : 0)))
+        {
+            return check_failer("mm_check", bp, "bad epilogue");
+        }
+    }
+    if (ar->heap_end == NULL)
+    {
+        return 0;
+    }
+    if ((GET_WORD(HEADER_PTR(ar->heap_end)) & ~PREV_ALLOC) != PACK_BLOCK(0, 1))
+    {
+        return check_failer("mm_check", ar->heap_end, "arena does not end in an epilogue");
+    }
+    if (level == MM_CHECK_BLOCK)
+    {
+        return 0;
+    }
+
+    // 클래스 리스트: 비트맵과 head가 맞는지, 블록마다 free이고 자기 클래스에 있는지
+    for (fl = 0; fl < FL_INDEX_COUNT; fl++)
+    {
+        if (!((ar->fl_bitmap >> fl) & 1) != !ar->sl_bitmap[fl])
+        {
+            return check_failer("mm_check", NULL, "first-level bitmap disagrees with the second level");
+        }
+        for (sl = 0; sl < SL_INDEX_COUNT; sl++)
+        {
+            if (!((ar->sl_bitmap[fl] >> sl) & 1) != !ar->free_lists[fl][sl])
+            {
+                return check_failer("mm_check", ar->free_lists[fl][sl], "second-level bitmap disagrees with the list");
+            }
+            prev = NULL;
+            for (bp = ar->free_lists[fl][sl]; bp != NULL; bp = GET_SUCC(bp))
+            {
+                int bfl, bsl;
+                if (bp < heap_base || bp > (char *)mem_heap_hi() || listed++ > free_blocks)
+                {
+                    return check_failer("mm_check", bp, "free list leaves the heap or loops");
+                }
+                size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+                mapping_insert(size, &bfl, &bsl);
+                if (GET_ALLOC_STATUS(HEADER_PTR(bp)) || size >= LARGE_BLOCK_SIZE || bfl != fl || bsl != sl)
+                {
+                    return check_failer("mm_check", bp, "listed block is not a free block of its class");
+                }
+                if (GET_PRED(bp) != prev)
+                {
+                    return check_failer("mm_check", bp, "free list links disagree");
+                }
+                prev = bp;
+            }
+        }
+    }
+
+    // 큰 블록 트리
+    if (IS_RED(ar->large_root))
+    {
+        return check_failer("mm_check", ar->large_root, "red tree root");
+    }
+    prev = NULL;
+    if (tree_checker(ar->large_root, NULL, &prev, &listed) < 0)
+    {
+        return -1;
+    }
+    if (listed != free_blocks)
+    {
+        return check_failer("mm_check", NULL, "free index and heap disagree on the number of free blocks");
+    }
+    return 0;
+}
+
+/*
+ * tree_checker - Check the subtree under node (parent links, colours,
+ *     (size, address) order through *prev, free blocks of at least
+ *     LARGE_BLOCK_SIZE) and add its nodes to *count. Returns its black
+ *     height, or -1 after printing the problem.
+ */
+static int tree_checker(char *node, char *parent, char **prev, size_t *count)
+{
+    int left, right;
+
+    if (node == NULL)
+    {
+        return 1;
+    }
+    if (node < heap_base || node > (char *)mem_heap_hi())
+    {
+        return check_failer("mm_check", node, "tree link leaves the heap");
+    }
+    if (TREE_PARENT(node) != parent)
+    {
+        return check_failer("mm_check", node, "tree parent link disagrees");
+    }
+    if (GET_ALLOC_STATUS(HEADER_PTR(node)) || GET_BLOCK_SIZE(HEADER_PTR(node)) < LARGE_BLOCK_SIZE)
+    {
+        return check_failer("mm_check", node, "tree node is not a large free block");
+    }
+    if (IS_RED(node) && (IS_RED(TREE_LEFT(node)) || IS_RED(TREE_RIGHT(node))))
+    {
+        return check_failer("mm_check", node, "red tree node with a red child");
+    }
+    if ((left = tree_checker(TREE_LEFT(node), node, prev, count)) < 0)
+    {
+        return -1;
+    }
+    if (*prev != NULL && tree_compare(GET_BLOCK_SIZE(HEADER_PTR(*prev)), *prev, node) >= 0)
+    {
+        return check_failer("mm_check", node, "tree out of order");
+    }
+    *prev = node;
+    (*count)++;
+    if ((right = tree_checker(TREE_RIGHT(node), node, prev, count)) < 0)
+    {
+        return -1;
+    }
+    if (left != right)
+    {
+        return check_failer("mm_check", node, "tree black heights differ");
+    }
+    return left + !IS_RED(node);
+}
+
+/*
+ * check_failer - Report a failed check of bp and return -1.
+ */
+static int check_failer(const char *where, void *bp, const char *what)
+{
+    fprintf(stderr, "%s: %s (block %p)\n", where, what, bp);
+    return -1;
+}
+
+
+/*
+ * arena_current - Return the calling thread's arena. Threads are handed
+ *     arenas round-robin on their first allocation.
+ */
+static arena_t *arena_current(void)
+{
+#ifdef MM_THREADS
+    arena_t *ar;
+
+    // 처음 할당하는 스레드에는 arena를 차례대로 배정
+    if ((ar = thread_arena) == NULL)
+    {
+        ar = &arenas[__atomic_fetch_add(&next_arena, 1, __ATOMIC_RELAXED) % ARENA_COUNT];
+        thread_arena = ar;
+    }
+    return ar;
+#else
+    // arena가 하나뿐이면 고를 필요가 없음
+    return &arenas[0];
+#endif
+}
+
+/*
+ * arena_malloc - Allocate size bytes from the arena's slab front end or
+ *     TLSF index, extending the arena when no free block is large
+ *     enough. The caller holds the arena lock.
+ */
+static void *arena_malloc(arena_t *ar, size_t size)
+{
+    // 작은 요청은 warm-up 이후 slab에서 처리 (run 확보에 실패하면 일반 경로로)
+    if (size <= SLAB_MAX_SIZE)
+    {
+        if (ar->small_live >= SLAB_WARMUP)
+        {
+            void *slot = slab_alloc(ar, slab_class(size));
+            if (slot != NULL)
+            {
+                STAT_INC(slab_allocs);
+                return slot;
+            }
+        }
+        ar->small_live++;
+    }
+
+    // 힙 예약 범위를 넘는 요청은 블록 크기 계산이 넘치기 전에 거절 (segment에는 4워드가 더 필요)
+    if (size > heap_limit - 4 * DOUBLE_WORD_SIZE)
+    {
+        return NULL;
+    }
+
+    // 요청된 크기에 따라 조정된 블록 크기를 계산
+    size_t adjusted_size;
+    if (size <= MIN_BLOCK_SIZE - WORD_SIZE)
+    {
+        // 요청 크기가 최소 블록 크기 이하일 경우, 최소 블록 크기로 조정
+        adjusted_size = MIN_BLOCK_SIZE;
+    }
+    else
+    {
+        // 요청 크기 + 헤더 크기를 더하고, 8바이트 정렬 (할당 블록은 풋터가 없음)
+        adjusted_size = ALIGN(size + WORD_SIZE);
+    }
+
+    // 조정된 크기를 만족하는 적합한 블록을 찾기
+    char *block_pointer = fit_finder(ar, adjusted_size);
+
+    if (block_pointer == NULL)
+    {
+        // 적합한 블록이 없으면 힙을 확장하여 새 블록 할당
+        block_pointer = heap_extender(ar, adjusted_size / WORD_SIZE);
+
+        // 힙 확장이 실패하면 NULL 반환
+        if (block_pointer == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    // 찾은 블록 또는 확장된 블록에 요청 크기를 배치
+    placer(ar, block_pointer, adjusted_size);
+
+    // 사용 가능한 블록의 시작 주소 반환
+    return block_pointer;
+}
+
+/*
+ * arena_free - Mark the block free and merge it with its free
+ *     neighbours, or hand a slab slot back to its run. The caller holds
+ *     the lock of the arena that owns ptr.
+ */
+static void arena_free(arena_t *ar, void *ptr)
+{
+    // slab 슬롯은 페이지 맵으로 구분하여 run에 반환
+    if (IS_SLAB_PTR(ptr))
+    {
+        slab_free(ar, ptr);
+        return;
+    }
+
+    // 현재 블록의 크기를 가져옴
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(ptr));
+
+    // 작은 객체 수 갱신 (warm-up 판단용 근사치)
+    if (size <= SLAB_BLOCK_LIMIT && ar->small_live > 0)
+    {
+        ar->small_live--;
+    }
+
+    run_releaser(ar, ptr, size);
+}
+
+/*
+ * run_releaser - Turn the size bytes of allocated blocks starting at
+ *     bp into one free block, merge it with its free neighbours and
+ *     trim the heap top if it grew large. The caller holds the arena
+ *     lock.
+ */
+static void run_releaser(arena_t *ar, char *bp, size_t size)
+{
+    // 블록의 헤더와 풋터를 free 상태로 설정 (이전 블록의 할당 비트는 유지)
+    PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0) | GET_PREV_ALLOC(HEADER_PTR(bp))); // 헤더에 크기와 할당 상태 저장
+    PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));                                  // 풋터에 크기와 할당 상태 저장
+
+    // 현재 블록을 병합하여 단편화를 줄이고 free 인덱스에 등록
+    bp = coalescer(ar, bp);
+
+    // 병합 결과가 힙 끝의 큰 free 블록이면 memlib에 반환
+    if (trim_threshold > 0 && GET_BLOCK_SIZE(HEADER_PTR(bp)) > trim_threshold)
+    {
+        heap_trimmer(ar, bp);
+    }
+}
+
+/*
+ * address_compare - qsort comparator ordering pointers by address.
+ */
+static int address_compare(const void *a, const void *b)
+{
+    char *p = *(char *const *)a;
+    char *q = *(char *const *)b;
+
+    return (p > q) - (p < q);
+}
+
+/*
+ * region_refiller - Serve an arena request of size (aligned) bytes that
+ *     does not fit in the current chunk. Large requests get a block of
+ *     their own so the rest of the chunk is not wasted; others start a
+ *     new chunk twice the size of the previous one.
+ */
+static void *region_refiller(mm_arena_t *arena, size_t size)
+{
+    region_chunk_t *chunk;
+    size_t chunk_size = arena->chunk_size;
+    int big = size > chunk_size / 4;
+
+    // 큰 객체는 딱 맞는 블록에, 나머지는 새 chunk에
+    if ((chunk = mm_malloc(big ? REGION_HEADER + size : chunk_size - WORD_SIZE)) == NULL)
+    {
+        return NULL;
+    }
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    if (big)
+    {
+        return (char *)chunk + REGION_HEADER;
+    }
+
+    arena->cur = (char *)chunk + REGION_HEADER + size;
+    arena->end = (char *)chunk + mm_malloc_usable_size(chunk);
+    arena->chunk_size = MAX_VALUE(chunk_size, MIN_VALUE(2 * chunk_size, REGION_MAX_CHUNK));
+    return (char *)chunk + REGION_HEADER;
+}
+
+
+/*
+ * pool_magazine - Return the calling thread's magazine for pool. The
+ *     slot is picked by pool number; a magazine left there by another
+ *     pool goes back to that pool first, or is dropped if the pool has
+ *     since been destroyed.
+ */
+static pool_magazine_t *pool_magazine(mm_pool_t *pool)
+{
+    pool_magazine_t *mag = &pool_magazines[(pool - pools) % POOL_MAGAZINE_SLOTS];
+    unsigned int generation = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+
+    if (mag->pool != pool || mag->generation != generation)
+    {
+        magazine_flusher(mag);
+        mag->pool = pool;
+        mag->generation = generation;
+#ifdef MM_THREADS
+        // 스레드가 끝날 때 tcache_flush가 magazine도 돌려주도록 등록
+        pthread_setspecific(tcache_key, &tcache);
+#endif
+    }
+    return mag;
+}
+
+
+/*
+ * magazine_loader - Refill the empty magazine with a full chain from
+ *     the depot, or else carve up to POOL_MAGAZINE_SIZE objects from
+ *     the pool's chunk, taking a new chunk from the heap if needed.
+ *     Returns the new count (0 when out of memory).
+ */
+static unsigned int magazine_loader(mm_pool_t *pool, pool_magazine_t *mag)
+{
+    arena_t *ar;
+    size_t chunk_size;
+    char *chunk;
+
+    if ((mag->head = depot_pop(pool, &mag->count)) != NULL)
+    {
+        return mag->count;
+    }
+
+    // depot이 비었으면 chunk에서 잘라냄 (여기서만 잠금)
+    POOL_LOCK(pool);
+    while (mag->count < POOL_MAGAZINE_SIZE)
+    {
+        if (pool->cur == NULL || pool->obj_size > (size_t)(pool->end - pool->cur))
+        {
+            // 힙에서 새 chunk를 받음 (mmap 문턱과 상관없이 항상 힙에, 그래야 오프셋으로 연결 가능)
+            chunk_size = MAX_VALUE(POOL_CHUNK_SIZE, POOL_CHUNK_HEADER + POOL_MAGAZINE_SIZE * pool->obj_size);
+            ar = arena_current();
+            ARENA_LOCK(ar);
+            chunk = arena_malloc(ar, chunk_size);
+            ARENA_UNLOCK(ar);
+            if (chunk == NULL)
+            {
+                break;
+            }
+            *(char **)chunk = pool->chunks;
+            pool->chunks = chunk;
+            pool->cur = chunk + POOL_CHUNK_HEADER;
+            pool->end = chunk + chunk_size;
+        }
+        PUT_WORD(pool->cur, PTR_TO_OFFSET(mag->head));
+        mag->head = pool->cur;
+        mag->count++;
+        pool->cur += pool->obj_size;
+    }
+    POOL_UNLOCK(pool);
+    return mag->count;
+}
+
+
+/*
+ * magazine_flusher - Give the magazine's objects back to the depot of
+ *     its pool, unless that pool was destroyed since, and empty it.
+ */
+static void magazine_flusher(pool_magazine_t *mag)
+{
+    if (mag->count > 0 && __atomic_load_n(&mag->pool->generation, __ATOMIC_ACQUIRE) == mag->generation)
+    {
+        depot_push(mag->pool, mag->head, mag->count);
+    }
+    mag->head = NULL;
+    mag->count = 0;
+}
+
+
+/*
+ * depot_push - Push a chain of count objects, linked through their
+ *     first words, onto the pool's depot with one CAS. The chain's
+ *     first object also holds the link to the next chain and the count.
+ */
+static void depot_push(mm_pool_t *pool, char *chain, unsigned int count)
+{
+    unsigned long long old_head, new_head;
+
+    PUT_WORD(CHAIN_COUNT(chain), count);
+    old_head = __atomic_load_n(&pool->depot, __ATOMIC_RELAXED);
+    do
+    {
+        PUT_WORD(CHAIN_NEXT(chain), DEPOT_OFFSET(old_head));
+        new_head = DEPOT_HEAD(DEPOT_TAG(old_head) + 1, PTR_TO_OFFSET(chain));
+    } while (!__atomic_compare_exchange_n(&pool->depot, &old_head, new_head, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+
+/*
+ * depot_pop - Pop the top chain off the pool's depot and store its
+ *     object count in *count. Returns NULL if the depot is empty. The
+ *     next link may be read from a chain another thread has just
+ *     taken; the tag in the head makes that CAS fail, and the memory
+ *     stays readable because chunks live as long as the pool.
+ */
+static char *depot_pop(mm_pool_t *pool, unsigned int *count)
+{
+    unsigned long long old_head, new_head;
+    char *chain;
+
+    old_head = __atomic_load_n(&pool->depot, __ATOMIC_ACQUIRE);
+    do
+    {
+        if (DEPOT_OFFSET(old_head) == 0)
+        {
+            return NULL;
+        }
+        chain = heap_base + DEPOT_OFFSET(old_head);
+        new_head = DEPOT_HEAD(DEPOT_TAG(old_head) + 1, GET_WORD(CHAIN_NEXT(chain)));
+    } while (!__atomic_compare_exchange_n(&pool->depot, &old_head, new_head, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    *count = GET_WORD(CHAIN_COUNT(chain));
+    return chain;
+}
+
+
+/*
+ * handle_reserver - Take a handle from the free list, or a new slot at
+ *     the end of the table, doubling its mapping when it is full.
+ *     Returns 0 if the table cannot grow. The caller holds the handle
+ *     lock.
+ */
+static unsigned int handle_reserver(void)
+{
+    handle_entry_t *table;
+    unsigned int handle, capacity;
+
+    if ((handle = handle_free) != 0)
+    {
+        handle_free = handle_table[handle - 1].next;
+        return handle;
+    }
+
+    // 표가 가득 차면 두 배 크기의 mapping으로 옮김
+    if (handle_count == handle_capacity)
+    {
+        capacity = handle_capacity ? 2 * handle_capacity : HANDLE_TABLE_MIN;
+        table = mmap(NULL, capacity * sizeof(handle_entry_t), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (table == MAP_FAILED)
+        {
+            return 0;
+        }
+        if (handle_table != NULL)
+        {
+            memcpy(table, handle_table, handle_count * sizeof(handle_entry_t));
+            munmap(handle_table, handle_capacity * sizeof(handle_entry_t));
+        }
+        handle_table = table;
+        handle_capacity = capacity;
+    }
+    return ++handle_count;
+}
+
+
+/*
+ * segment_slider - Compact the segment whose first block is bp. Free
+ *     blocks are taken out of the index and open a gap; each unpinned
+ *     handle block after it is moved down to the gap start, so the gap
+ *     travels up the segment. Any other allocated block closes the gap
+ *     as one free block. A gap left at the end of the arena's top
+ *     segment is trimmed. Returns the number of bytes moved. The caller
+ *     holds the handle lock and the arena lock.
+ */
+static size_t segment_slider(arena_t *ar, char *bp)
+{
+    char *gap = NULL;
+    size_t moved = 0;
+    size_t size;
+    unsigned int header;
+
+    for (; (size = GET_BLOCK_SIZE(HEADER_PTR(bp))) != 0; bp += size)
+    {
+        header = GET_WORD(HEADER_PTR(bp));
+        if (!(header & 0x1))
+        {
+            // free 블록은 빈 구간에 합침 (free 블록 뒤는 항상 할당 블록이므로 빈 구간이 이어짐)
+            remove_free_block(ar, bp);
+            if (gap == NULL)
+            {
+                gap = bp;
+            }
+        }
+        else if (gap != NULL && (header & HANDLE_BLOCK) && handle_table[GET_WORD(HANDLE_INDEX(bp)) - 1].pins == 0)
+        {
+            // 고정되지 않은 handle 블록을 헤더째 빈 구간의 시작으로 옮기고 표를 갱신
+            memmove(HEADER_PTR(gap), HEADER_PTR(bp), size);
+            PUT_WORD(HEADER_PTR(gap), PACK_BLOCK(size, 1) | PREV_ALLOC | HANDLE_BLOCK);
+            handle_table[GET_WORD(HANDLE_INDEX(gap)) - 1].offset = PTR_TO_OFFSET(gap);
+            gap += size;
+            moved += size;
+        }
+        else if (gap != NULL)
+        {
+            // 옮길 수 없는 블록 앞에서 빈 구간을 free 블록으로 닫음
+            gap_closer(ar, gap, bp);
+            gap = NULL;
+        }
+    }
+
+    // 마지막 빈 구간은 에필로그 앞에서 닫고, 힙 끝이면 반환
+    if (gap != NULL)
+    {
+        gap_closer(ar, gap, bp);
+        if (trim_threshold > 0 && bp == ar->heap_end)
+        {
+            heap_trimmer(ar, gap);
+        }
+    }
+    return moved;
+}
+
+
+/*
+ * gap_closer - Turn the bytes from gap up to the allocated block bp
+ *     into one indexed free block.
+ */
+static void gap_closer(arena_t *ar, char *gap, char *bp)
+{
+    size_t size = bp - gap;
+
+    PUT_WORD(HEADER_PTR(gap), PACK_BLOCK(size, 0) | PREV_ALLOC);
+    PUT_WORD(FOOTER_PTR(gap), PACK_BLOCK(size, 0));
+    insert_free_block(ar, gap);
+    CLEAR_PREV_ALLOC(HEADER_PTR(bp));
+}
+
+
+/*
+ * arena_of - Find the arena owning ptr by binary search over the
+ *     segment table, which is sorted because segments are only ever
+ *     appended at the top of the heap.
+ */
+static arena_t *arena_of(void *ptr)
+{
+#ifdef MM_THREADS
+    int lo = 0;
+    int hi = __atomic_load_n(&segment_count, __ATOMIC_ACQUIRE) - 1;
+
+    // ptr 이하에서 시작하는 마지막 segment를 찾음
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if ((char *)ptr >= segments[mid].start)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return segments[lo].arena;
+#else
+    // arena가 하나뿐이면 찾을 필요가 없음
+    return &arenas[0];
+#endif
+}
+
+
+/*
+ * heap_extender - Grow the arena so that it ends in a free block of at
+ *     least words words and return that block. When the arena's last
+ *     segment still ends at the top of the heap the old epilogue becomes
+ *     the new block's header; otherwise a new segment with its own
+ *     prologue and epilogue is started and recorded in the segment
+ *     table. How much is asked from memlib depends on grow_policy:
+ *     MM_GROW_EXACT takes the full request, MM_GROW_SHORTFALL only what
+ *     a free block already ending the heap lacks, and MM_GROW_GEOMETRIC
+ *     additionally doubles the arena's growth step on every extension
+ *     up to grow_cap, so a growing heap needs few sbrk calls.
+ */
+static void *heap_extender(arena_t *ar, size_t words)
+{
+    // 확장할 힙 영역의 시작 포인터와 크기를 선언
+    char *bp;
+    char *start;
+    char *zero_lo;
+    size_t size;
+    size_t last_size;
+
+    // 요청된 word 수를 ALIGNMENT 단위로 올림 (segment 시작과 payload 정렬이 유지됨)
+    size = ALIGN(WORD_SIZE * words);
+
+    // 0인 영역의 시작은 전역이고 다른 arena의 축소로 움직이므로 sbrk 잠금 아래에서 읽음
+    SBRK_LOCK();
+    zero_lo = mem_zero_lo();
+    if (ar->heap_end != NULL && ar->heap_end == (char *)mem_heap_hi() + 1)
+    {
+        // 힙 끝이 free 블록이면 모자란 만큼만 확장 (이미 충분하면 그 블록을 그대로 반환)
+        if (grow_policy != MM_GROW_EXACT && !GET_PREV_ALLOC(HEADER_PTR(ar->heap_end)))
+        {
+            last_size = GET_BLOCK_SIZE(ar->heap_end - DOUBLE_WORD_SIZE);
+            if (last_size >= size)
+            {
+                SBRK_UNLOCK();
+                return ar->heap_end - last_size;
+            }
+            size -= last_size;
+        }
+        size = grow_size(ar, size);
+
+        // 힙을 정한 크기만큼 확장 (옛 에필로그가 새 블록의 헤더가 됨)
+        bp = mem_sbrk(size);
+
+        // 힙 확장이 실패한 경우 NULL 반환
+        if (bp == (void *)-1)
+        {
+            SBRK_UNLOCK();
+            return NULL;
+        }
+    }
+    else
+    {
+        // 다른 arena가 뒤에 확장했거나 첫 확장이면 새 segment를 시작
+#ifdef MM_THREADS
+        size = MAX_VALUE(size, SEGMENT_MIN_SIZE);
+#endif
+        size = grow_size(ar, size);
+        if (segment_count == MAX_SEGMENTS || (start = mem_sbrk(size + 4 * WORD_SIZE)) == (void *)-1)
+        {
+            SBRK_UNLOCK();
+            return NULL;
+        }
+
+        // 정렬 패딩(Alignment Padding): 첫 번째 워드는 정렬을 위해 비워둔다.
+        PUT_WORD(start, 0);
+
+        // Prologue Header/Footer: 더블 워드 크기(8바이트) 블록, 할당 상태로 설정
+        PUT_WORD(start + (1 * WORD_SIZE), PACK_BLOCK(DOUBLE_WORD_SIZE, 1) | PREV_ALLOC);
+        PUT_WORD(start + (2 * WORD_SIZE), PACK_BLOCK(DOUBLE_WORD_SIZE, 1));
+
+        // 임시 Epilogue Header: 새 블록이 이전 블록(프롤로그)의 할당 비트를 물려받도록 설정
+        PUT_WORD(start + (3 * WORD_SIZE), PACK_BLOCK(0, 1) | PREV_ALLOC);
+        bp = start + (4 * WORD_SIZE);
+
+        // segment 표에 추가 (읽는 쪽은 잠금 없이 개수를 먼저 읽음)
+        segments[segment_count].start = start;
+        segments[segment_count].arena = ar;
+#ifdef MM_THREADS
+        __atomic_store_n(&segment_count, segment_count + 1, __ATOMIC_RELEASE);
+#else
+        segment_count++;
+#endif
+    }
+    ar->heap_end = bp + size;
+    STAT_INC(heap_extends);
+
+    // 새 영역 중 zero_lo 위는 아직 0 (한 번의 할당 중 여러 번 확장했으면 가장 높은 표시가 모두에 대해 맞음)
+    if (ar->zero_lo == NULL || zero_lo > ar->zero_lo)
+    {
+        ar->zero_lo = zero_lo;
+    }
+
+    // 페이지 맵에서 mm_init이 지워야 할 범위 갱신
+    slab_map_hi = (((char *)mem_heap_hi() - heap_base) >> SLAB_RUN_SHIFT >> 5) + 1;
+    SBRK_UNLOCK();
+
+    // 새로 확장된 블록의 헤더와 풋터를 설정 (free 상태, 이전 블록 비트는 옛 에필로그에서 물려받음)
+    PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0) | GET_PREV_ALLOC(HEADER_PTR(bp)));  // 헤더 설정
+    PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));                                   // 풋터 설정
+
+    // 새로운 에필로그 헤더를 생성 (할당된 상태, 크기 0, 이전 블록은 free)
+    PUT_WORD(HEADER_PTR(NEXT_BLOCK_PTR(bp)), PACK_BLOCK(0, 1));
+
+    // 새로 확장된 블록을 병합하고 병합된 블록의 시작 포인터를 반환
+    return coalescer(ar, bp);
+}
+
+
+/*
+ * grow_size - Round an extension of size bytes up to the arena's
+ *     growth step under MM_GROW_GEOMETRIC and advance the step. The
+ *     caller holds the sbrk lock.
+ */
+static size_t grow_size(arena_t *ar, size_t size)
+{
+    // 최소 블록 크기보다 작은 free 블록은 만들 수 없음
+    size = MAX_VALUE(size, MIN_BLOCK_SIZE);
+    if (grow_policy != MM_GROW_GEOMETRIC)
+    {
+        return size;
+    }
+
+    // 확장할 때마다 단위를 두 배로 늘리되 grow_cap을 넘지 않음
+    size = MAX_VALUE(size, ar->grow_step);
+    ar->grow_step *= 2;
+    if (ar->grow_step > grow_cap)
+    {
+        ar->grow_step = MAX_VALUE(grow_cap, CHUNK_SIZE);
+    }
+    return size;
+}
+
+
+/*
+ * heap_trimmer - If the free block bp ends the arena's segment at the
+ *     top of the heap, shrink the heap so that about top_pad bytes of it
+ *     stay free. Only whole CHUNK_SIZE units are released, and since a
+ *     trim needs more than trim_threshold free bytes while it leaves
+ *     only top_pad behind, a workload hovering around the heap top does
+ *     not alternate between trimming and growing.
+ */
+static void heap_trimmer(arena_t *ar, char *bp)
+{
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    size_t release;
+
+    // 힙 끝에 있는 블록인지 확인
+    if (NEXT_BLOCK_PTR(bp) != ar->heap_end || size <= top_pad)
+    {
+        return;
+    }
+
+    // top_pad만큼 남기고 CHUNK_SIZE 단위로 반환 (남는 블록은 0이거나 최소 블록 크기 이상)
+    release = (size - top_pad) & ~(size_t)(CHUNK_SIZE - 1);
+    if (size - release != 0 && size - release < MIN_BLOCK_SIZE)
+    {
+        release -= CHUNK_SIZE;
+    }
+    if (release == 0)
+    {
+        return;
+    }
+
+    // 반환할 페이지는 내용이 사라지므로 링크를 먼저 인덱스에서 떼어냄
+    remove_free_block(ar, bp);
+    SBRK_LOCK();
+    if (ar->heap_end != (char *)mem_heap_hi() + 1 || mem_sbrk(-(intptr_t)release) == (void *)-1)
+    {
+        // 다른 arena의 segment가 뒤에 있으면 줄일 수 없음
+        SBRK_UNLOCK();
+        insert_free_block(ar, bp);
+        return;
+    }
+    ar->heap_end -= release;
+    SBRK_UNLOCK();
+    STAT_INC(heap_trims);
+#if MM_FIT == MM_FIT_NEXT
+    // 반환된 영역은 더 이상 블록이 아니므로 rover를 처음으로 되돌림
+    if (ar->rover >= ar->heap_end)
+    {
+        ar->rover = NULL;
+    }
+#endif
+
+    // 남은 부분을 free 블록으로 다시 등록하고 새 에필로그를 씀
+    size -= release;
+    if (size > 0)
+    {
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0) | PREV_ALLOC);
+        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));
+        insert_free_block(ar, bp);
+        PUT_WORD(HEADER_PTR(NEXT_BLOCK_PTR(bp)), PACK_BLOCK(0, 1));
+    }
+    else
+    {
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(0, 1) | PREV_ALLOC);
+    }
+}
+
+
+/*
+ * mmap_alloc - Put a request of size bytes in its own mapping. The
+ *     mapping starts with its length; the payload follows a header
+ *     tagged MMAPPED. Returns NULL if memlib cannot map it.
+ */
+static void *mmap_alloc(size_t size)
+{
+    size_t length;
+    char *start;
+    char *bp;
+
+    // 페이지 올림이 넘치는 크기는 매핑할 수 없음
+    if (size > SIZE_MAX - MMAP_OVERHEAD - page_size)
+    {
+        return NULL;
+    }
+    length = (size + MMAP_OVERHEAD + page_size - 1) & ~(page_size - 1);
+
+    SBRK_LOCK();
+    start = mem_map(length);
+    SBRK_UNLOCK();
+    if (start == NULL)
+    {
+        return NULL;
+    }
+
+    bp = start + MMAP_OVERHEAD;
+    MMAP_LENGTH(bp) = length;
+    PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(0, 1) | MMAPPED);
+    STAT_INC(mmap_allocs);
+    return bp;
+}
+
+/*
+ * mmap_realloc - Resize a mapped block. While the new size is still at
+ *     or above the mmap threshold the mapping is resized with mremap,
+ *     which moves pages instead of copying them; smaller sizes move the
+ *     data back into the heap.
+ */
+static void *mmap_realloc(void *ptr, size_t size)
+{
+    size_t length = MMAP_LENGTH(ptr);
+    size_t new_length;
+    size_t copy_size;
+    char *start;
+    void *new_ptr;
+
+    // 페이지 올림이 넘치는 크기는 실패로 돌려주고 블록은 그대로 둠
+    if (size > SIZE_MAX - MMAP_OVERHEAD - page_size)
+    {
+        return NULL;
+    }
+    new_length = (size + MMAP_OVERHEAD + page_size - 1) & ~(page_size - 1);
+
+    if (mmap_threshold > 0 && size >= mmap_threshold)
+    {
+        // 페이지 수가 같으면 그대로 사용
+        if (new_length == length)
+        {
+            return ptr;
+        }
+        SBRK_LOCK();
+        start = mem_remap(MMAP_START(ptr), new_length);
+        SBRK_UNLOCK();
+        if (start == NULL)
+        {
+            return NULL;
+        }
+        MMAP_LENGTH(start + MMAP_OVERHEAD) = new_length;
+        return start + MMAP_OVERHEAD;
+    }
+
+    // 작아진 블록은 힙으로 옮김 (임계값이 바뀌었으면 커질 수도 있으므로 기존 매핑 크기까지만 복사)
+    if ((new_ptr = mm_malloc(size)) == NULL)
+    {
+        return NULL;
+    }
+    copy_size = MIN_VALUE(size, length - MMAP_OVERHEAD);
+    memcpy(new_ptr, ptr, copy_size);
+    COUNT_COPY(copy_size);
+    mmap_free(ptr);
+    return new_ptr;
+}
+
+/*
+ * mmap_free - Unmap a mapped block, returning its memory to the OS.
+ */
+static void mmap_free(void *ptr)
+{
+    SBRK_LOCK();
+    mem_unmap(MMAP_START(ptr));
+    SBRK_UNLOCK();
+}
+
+
+/*
+ * next_free_size - Return the size of the block after bp if it is free,
+ *     0 otherwise.
+ */
+static size_t next_free_size(void *bp)
+{
+    char *next_ptr = NEXT_BLOCK_PTR(bp);
+
+    return GET_ALLOC_STATUS(HEADER_PTR(next_ptr)) ? 0 : GET_BLOCK_SIZE(HEADER_PTR(next_ptr));
+}
+
+/*
+ * next_absorber - Grow the allocated block bp over the free block that
+ *     follows it (if any) and keep the first asize bytes, returning the
+ *     rest to the index.
+ */
+static void next_absorber(arena_t *ar, void *bp, size_t asize)
+{
+    char *next_ptr = NEXT_BLOCK_PTR(bp);
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+
+    if (!GET_ALLOC_STATUS(HEADER_PTR(next_ptr)))
+    {
+        // 흡수할 free 블록을 인덱스에서 제거하고 헤더를 갱신
+        remove_free_block(ar, next_ptr);
+        size += GET_BLOCK_SIZE(HEADER_PTR(next_ptr));
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 1) | GET_PREV_ALLOC(HEADER_PTR(bp)));
+        SET_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(bp)));
+        ROVER_MERGE(ar, bp);
+    }
+    tail_splitter(ar, bp, asize);
+}
+
+/*
+ * tail_splitter - Shrink the allocated block bp to asize bytes when the
+ *     tail is big enough to be a block of its own. The tail is merged
+ *     with a free successor and indexed, and may trim the heap top.
+ */
+static void tail_splitter(arena_t *ar, void *bp, size_t asize)
+{
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    char *tail_ptr;
+
+    if (size - asize < MM_SPLIT_THRESHOLD)
+    {
+        return;
+    }
+
+    // 앞부분은 할당 상태로 두고 뒷부분을 free 블록으로 만듦
+    PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(asize, 1) | GET_PREV_ALLOC(HEADER_PTR(bp)));
+    tail_ptr = NEXT_BLOCK_PTR(bp);
+    PUT_WORD(HEADER_PTR(tail_ptr), PACK_BLOCK(size - asize, 0) | PREV_ALLOC);
+    PUT_WORD(FOOTER_PTR(tail_ptr), PACK_BLOCK(size - asize, 0));
+
+    // 뒤의 free 블록과 병합하여 인덱스에 등록 (힙 끝이면 반환될 수 있음)
+    tail_ptr = coalescer(ar, tail_ptr);
+    if (trim_threshold > 0 && GET_BLOCK_SIZE(HEADER_PTR(tail_ptr)) > trim_threshold)
+    {
+        heap_trimmer(ar, tail_ptr);
+    }
+}
+
+
+/*
+ * coalescer - Merge the free block bp with its free neighbours. The
+ *     neighbours are taken out of the TLSF index and the merged block
+ *     is inserted back, so the caller must not have indexed bp itself.
+ *     Because free neighbours are always merged, the block before a free
+ *     block is allocated, so every free header carries PREV_ALLOC.
+ */
+static void *coalescer(arena_t *ar, void *bp)
+{
+    // 이전 블록과 다음 블록의 할당 상태를 확인 (이전 블록은 헤더의 bit 1로 확인)
+    size_t prev_alloc = GET_PREV_ALLOC(HEADER_PTR(bp));
+    size_t next_alloc = GET_ALLOC_STATUS(HEADER_PTR(NEXT_BLOCK_PTR(bp)));
+
+    // 현재 블록의 크기를 가져옴
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+
+    // Case 1: 이전 블록과 다음 블록 모두 할당된 상태
+    if (prev_alloc && next_alloc)
+    {
+        CLEAR_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(bp))); // 다음 블록에 free 상태를 알림
+        insert_free_block(ar, bp);                            // 병합 없이 인덱스에 등록
+        STAT_INC(coalesce[0]);
+        return bp;
+    }
+
+    // Case 2: 이전 블록은 할당되고 다음 블록은 free 상태
+    if (prev_alloc && !next_alloc)
+    {
+        remove_free_block(ar, NEXT_BLOCK_PTR(bp));                  // 다음 블록을 인덱스에서 제거
+        size += GET_BLOCK_SIZE(HEADER_PTR(NEXT_BLOCK_PTR(bp))); // 다음 블록 크기 추가
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0) | PREV_ALLOC); // 헤더 갱신
+        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));              // 풋터 갱신
+        STAT_INC(coalesce[1]);
+    }
+
+    // Case 3: 이전 블록은 free 상태이고 다음 블록은 할당된 상태
+    else if (!prev_alloc && next_alloc)
+    {
+        remove_free_block(ar, PREVIOUS_BLOCK_PTR(bp));                  // 이전 블록을 인덱스에서 제거
+        size += GET_BLOCK_SIZE(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))); // 이전 블록 크기 추가
+        CLEAR_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(bp)));          // 다음 블록에 free 상태를 알림
+        bp = PREVIOUS_BLOCK_PTR(bp);                               // 블록 포인터를 이전 블록으로 이동
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 0) | PREV_ALLOC); // 이전 블록 헤더 갱신
+        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(size, 0));             // 풋터 갱신
+        STAT_INC(coalesce[2]);
+    }
+
+    // Case 4: 이전 블록과 다음 블록 모두 free 상태
+    else
+    {
+        remove_free_block(ar, PREVIOUS_BLOCK_PTR(bp));      // 이전 블록을 인덱스에서 제거
+        remove_free_block(ar, NEXT_BLOCK_PTR(bp));          // 다음 블록을 인덱스에서 제거
+        size += GET_BLOCK_SIZE(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp))) +
+                GET_BLOCK_SIZE(FOOTER_PTR(NEXT_BLOCK_PTR(bp))); // 이전 및 다음 블록 크기 추가
+        PUT_WORD(HEADER_PTR(PREVIOUS_BLOCK_PTR(bp)), PACK_BLOCK(size, 0) | PREV_ALLOC); // 이전 블록 헤더 갱신
+        PUT_WORD(FOOTER_PTR(NEXT_BLOCK_PTR(bp)), PACK_BLOCK(size, 0));     // 다음 블록 풋터 갱신
+        bp = PREVIOUS_BLOCK_PTR(bp);                                       // 블록 포인터를 이전 블록으로 이동
+        STAT_INC(coalesce[3]);
+    }
+
+    // 병합된 블록을 인덱스에 등록하고, 사라진 경계를 가리키던 rover를 블록 시작으로 옮김
+    insert_free_block(ar, bp);
+    ROVER_MERGE(ar, bp);
+
+    // 병합된 블록의 시작 포인터 반환
+    return bp;
+}
+
+
+/*
+ * fit_finder - Find a free block of at least size bytes with the
+ *     compiled-in placement policy. The telemetry build also counts the
+ *     blocks the search looked at.
+ */
+static void *fit_finder(arena_t *ar, size_t size)
+{
+#ifdef MM_STATS
+    void *bp;
+
+    ar->visits = 0;
+    bp = fit_searcher(ar, size);
+    STAT_INC(searches);
+    STAT_ADD(search_visits, ar->visits);
+    STAT_INC(search_hist[STAT_BUCKET(ar->visits)]);
+    if (bp == NULL)
+    {
+        STAT_INC(search_misses);
+    }
+    return bp;
+#else
+    return fit_searcher(ar, size);
+#endif
+}
+
+
+#if MM_FIT_WALKS
+/*
+ * fit_searcher - Walk the arena's segments block by block in address
+ *     order and return the first free block of at least size bytes.
+ *     Under MM_FIT_NEXT the walk resumes at the rover, the block the
+ *     last search chose, and wraps around to the start of the arena and
+ *     back up to the rover; merges and trims keep the rover on a block
+ *     start, so a hit costs only the blocks between two choices.
+ */
+static void *fit_searcher(arena_t *ar, size_t size)
+{
+    char *bp;
+    int i;
+
+#if MM_FIT == MM_FIT_NEXT
+    int count = segment_count;
+    int first = (ar->rover != NULL) ? ar->rover_segment : 0;
+    int k;
+
+    // rover의 segment부터 한 바퀴 돌고, 마지막으로 rover의 segment 앞부분을 rover까지 훑음
+    for (k = 0; count > 0 && k <= count; k++)
+    {
+        i = (first + k) % count;
+        if (segments[i].arena != ar || (k == count && ar->rover == NULL))
+        {
+            continue;
+        }
+        bp = (k == 0 && ar->rover != NULL) ? ar->rover : segments[i].start + 4 * WORD_SIZE;
+        if ((bp = block_walker(ar, bp, (k == count) ? ar->rover : NULL, size)) != NULL)
+        {
+            ar->rover = bp;
+            ar->rover_segment = i;
+            return bp;
+        }
+    }
+    return NULL;
+#else
+    for (i = 0; i < segment_count; i++)
+    {
+        if (segments[i].arena == ar && (bp = block_walker(ar, segments[i].start + 4 * WORD_SIZE, NULL, size)) != NULL)
+        {
+            return bp;
+        }
+    }
+    return NULL;
+#endif
+}
+
+/*
+ * block_walker - Return the first free block of at least size bytes
+ *     from bp up to stop, or up to the segment's epilogue when stop is
+ *     NULL; NULL if there is none.
+ */
+static void *block_walker(arena_t *ar, char *bp, char *stop, size_t size)
+{
+    for (; bp != stop && GET_BLOCK_SIZE(HEADER_PTR(bp)) != 0; bp = NEXT_BLOCK_PTR(bp))
+    {
+        STAT_VISIT(ar);
+        if (!GET_ALLOC_STATUS(HEADER_PTR(bp)) && GET_BLOCK_SIZE(HEADER_PTR(bp)) >= size)
+        {
+            return bp;
+        }
+    }
+    return NULL;
+}
+
+#else
+/*
+ * fit_searcher - Find a free block of at least size bytes in the TLSF
+ *     lists. Requests of LARGE_BLOCK_SIZE or more, and small ones that
+ *     no list can serve, take the best fit from the red-black tree.
+ *     MM_FIT_GOOD rounds small requests up to the next class boundary
+ *     so that any block of the returned list fits in O(1), and only
+ *     then scans the request's own class. MM_FIT_FIRST scans the own
+ *     class first and takes the first block that fits in list order,
+ *     then the head of the next non-empty class. MM_FIT_BEST takes the
+ *     smallest fitting block of the own class or, failing that, of the
+ *     next non-empty class.
+ */
+static void *fit_searcher(arena_t *ar, size_t size)
+{
+    int fl, sl;
+    char *bp;
+#if MM_FIT == MM_FIT_BEST
+    char *best = NULL;
+#endif
+
+    // 큰 요청은 트리에서 best fit
+    if (size >= LARGE_BLOCK_SIZE)
+    {
+        return tree_best_fit(ar, size);
+    }
+
+#if MM_FIT == MM_FIT_GOOD
+    // 요청 크기를 올림한 클래스부터 찾으면 첫 블록은 항상 요청 크기 이상
+    mapping_search(size, &fl, &sl);
+    if ((bp = class_finder(ar, &fl, &sl)) != NULL)
+    {
+        return bp;
+    }
+
+    // 올림으로 건너뛴 요청 크기 자신의 클래스를 마지막으로 확인
+    mapping_insert(size, &fl, &sl);
+    for (bp = ar->free_lists[fl][sl]; bp != NULL; bp = GET_SUCC(bp))
+    {
+        STAT_VISIT(ar);
+        if (size <= GET_BLOCK_SIZE(HEADER_PTR(bp)))
+        {
+            return bp;
+        }
+    }
+#elif MM_FIT == MM_FIT_FIRST
+    // 요청 크기 자신의 클래스에서 리스트 순서대로 처음 맞는 블록
+    mapping_insert(size, &fl, &sl);
+    for (bp = ar->free_lists[fl][sl]; bp != NULL; bp = GET_SUCC(bp))
+    {
+        STAT_VISIT(ar);
+        if (size <= GET_BLOCK_SIZE(HEADER_PTR(bp)))
+        {
+            return bp;
+        }
+    }
+
+    // 더 큰 클래스의 블록은 모두 맞으므로 첫 블록
+    sl++;
+    if ((bp = class_finder(ar, &fl, &sl)) != NULL)
+    {
+        return bp;
+    }
+#elif MM_FIT == MM_FIT_BEST
+    // 요청 크기 자신의 클래스에서 가장 작은 맞는 블록 (딱 맞으면 바로 반환)
+    mapping_insert(size, &fl, &sl);
+    for (bp = ar->free_lists[fl][sl]; bp != NULL; bp = GET_SUCC(bp))
+    {
+        STAT_VISIT(ar);
+        if (size <= GET_BLOCK_SIZE(HEADER_PTR(bp)) &&
+            (best == NULL || GET_BLOCK_SIZE(HEADER_PTR(bp)) < GET_BLOCK_SIZE(HEADER_PTR(best))))
+        {
+            best = bp;
+            if (GET_BLOCK_SIZE(HEADER_PTR(bp)) == size)
+            {
+                break;
+            }
+        }
+    }
+
+    // 없으면 다음 비어있지 않은 클래스에서 가장 작은 블록
+    sl++;
+    if (best == NULL && (bp = class_finder(ar, &fl, &sl)) != NULL)
+    {
+        for (best = bp; bp != NULL; bp = GET_SUCC(bp))
+        {
+            STAT_VISIT(ar);
+            if (GET_BLOCK_SIZE(HEADER_PTR(bp)) < GET_BLOCK_SIZE(HEADER_PTR(best)))
+            {
+                best = bp;
+            }
+        }
+    }
+    if (best != NULL)
+    {
+        return best;
+    }
+#else
+#error "unknown MM_FIT placement policy"
+#endif
+
+    // 작은 블록이 없으면 가장 작은 큰 블록을 분할 (없으면 NULL)
+    return tree_best_fit(ar, size);
+}
+
+/*
+ * class_finder - Return the head of the first non-empty list at class
+ *     (fl, sl) or above and update fl and sl to that class, or return
+ *     NULL. sl may be SL_INDEX_COUNT, meaning the start of class fl+1.
+ */
+static char *class_finder(arena_t *ar, int *fl, int *sl)
+{
+    unsigned int sl_map, fl_map;
+
+    if (*fl >= FL_INDEX_COUNT)
+    {
+        return NULL;
+    }
+
+    // 같은 1단계 클래스에서 sl 이상인 2단계 클래스 탐색
+    sl_map = (*sl < SL_INDEX_COUNT) ? (ar->sl_bitmap[*fl] & (~0U << *sl)) : 0;
+    if (sl_map == 0)
+    {
+        // 없으면 더 큰 1단계 클래스 탐색
+        fl_map = (*fl + 1 < 32) ? (ar->fl_bitmap & (~0U << (*fl + 1))) : 0;
+        if (fl_map == 0)
+        {
+            return NULL;
+        }
+        *fl = __builtin_ctz(fl_map);
+        sl_map = ar->sl_bitmap[*fl];
+    }
+    *sl = __builtin_ctz(sl_map);
+    STAT_VISIT(ar);
+    return ar->free_lists[*fl][*sl];
+}
+#endif
+
+/*
+ * placer - Allocate asize bytes at the start of the indexed free block
+ *     bp, returning the remainder to the index when it is large enough
+ *     to form a block of its own.
+ */
+static void placer(arena_t *ar, void *bp, size_t size)
+{
+    // 현재 블록의 크기를 가져옴
+    size_t current_size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+
+    // 할당할 블록을 인덱스에서 제거
+    remove_free_block(ar, bp);
+
+    // Case 1: 블록을 분할할 수 있을 만큼 충분히 큰 경우
+    if ((current_size - size) >= MM_SPLIT_THRESHOLD)
+    {
+        // 현재 블록을 요청된 크기로 설정 (aligned_block이 앞쪽 조각을 떼어낸 경우 이전 블록이 free일 수 있으므로 bit 1은 유지)
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(size, 1) | GET_PREV_ALLOC(HEADER_PTR(bp)));  // 헤더 설정
+
+        // 분할 후 남은 공간을 새로운 free 블록으로 설정 (그 다음 블록의 bit 1은 이미 0)
+        void *next_bp = NEXT_BLOCK_PTR(bp);             // 다음 블록의 시작 주소 계산
+        PUT_WORD(HEADER_PTR(next_bp), PACK_BLOCK(current_size - size, 0) | PREV_ALLOC); // 헤더 갱신
+        PUT_WORD(FOOTER_PTR(next_bp), PACK_BLOCK(current_size - size, 0));              // 풋터 갱신
+
+        // 남은 free 블록을 인덱스에 등록
+        insert_free_block(ar, next_bp);
+        STAT_INC(splits);
+
+    // Case 2: 블록을 분할할 수 없을 만큼 작은 경우
+    } else
+    {
+        // 현재 블록 전체를 할당 상태로 설정하고 다음 블록에 알림
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(current_size, 1) | GET_PREV_ALLOC(HEADER_PTR(bp))); // 헤더 설정
+        SET_PREV_ALLOC(HEADER_PTR(NEXT_BLOCK_PTR(bp)));                     // 다음 블록 헤더 갱신
+        STAT_INC(whole_fits);
+    }
+}
+
+
+/*
+ * mapping_insert - Compute the (fl, sl) class that a free block of the
+ *     given size is filed under.
+ */
+static void mapping_insert(size_t size, int *fl, int *sl)
+{
+    if (size < SMALL_BLOCK_SIZE)
+    {
+        // 작은 크기는 1단계 0번 클래스에 ALIGNMENT 간격으로 선형 매핑
+        *fl = 0;
+        *sl = (int)size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+    }
+    else
+    {
+        // 최상위 비트로 1단계, 그 아래 SL_INDEX_LOG2 비트로 2단계를 결정
+        int msb = 31 - __builtin_clz((unsigned int)size);
+        *sl = (int)(size >> (msb - SL_INDEX_LOG2)) ^ SL_INDEX_COUNT;
+        *fl = msb - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+#if MM_FIT == MM_FIT_GOOD
+/*
+ * mapping_search - Like mapping_insert, but round size up to the next
+ *     class boundary first so every block in the resulting class fits.
+ */
+static void mapping_search(size_t size, int *fl, int *sl)
+{
+    if (size >= SMALL_BLOCK_SIZE)
+    {
+        // 2단계 클래스 폭 - 1 만큼 올림
+        int msb = 31 - __builtin_clz((unsigned int)size);
+        size += (1U << (msb - SL_INDEX_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+#endif
+
+/*
+ * insert_free_block - Push bp onto the head of its class list and mark
+ *     the class non-empty in both bitmaps.
+ */
+static void insert_free_block(arena_t *ar, void *bp)
+{
+    int fl, sl;
+    char *head;
+
+    // 큰 블록은 트리에 보관
+    if (GET_BLOCK_SIZE(HEADER_PTR(bp)) >= LARGE_BLOCK_SIZE)
+    {
+        tree_insert(ar, bp);
+        return;
+    }
+
+    mapping_insert(GET_BLOCK_SIZE(HEADER_PTR(bp)), &fl, &sl);
+    head = ar->free_lists[fl][sl];
+
+    // LIFO: 리스트 맨 앞에 삽입
+    SET_PRED(bp, NULL);
+    SET_SUCC(bp, head);
+    if (head != NULL)
+    {
+        SET_PRED(head, bp);
+    }
+    ar->free_lists[fl][sl] = bp;
+
+    // 비트맵 갱신
+    ar->fl_bitmap |= 1U << fl;
+    ar->sl_bitmap[fl] |= 1U << sl;
+}
+
+/*
+ * remove_free_block - Unlink bp from its class list, clearing the
+ *     bitmap bits when the list becomes empty.
+ */
+static void remove_free_block(arena_t *ar, void *bp)
+{
+    int fl, sl;
+    char *pred = GET_PRED(bp);
+    char *succ = GET_SUCC(bp);
+
+    // 큰 블록은 트리에서 제거
+    if (GET_BLOCK_SIZE(HEADER_PTR(bp)) >= LARGE_BLOCK_SIZE)
+    {
+        tree_remove(ar, bp);
+        return;
+    }
+
+    mapping_insert(GET_BLOCK_SIZE(HEADER_PTR(bp)), &fl, &sl);
+
+    if (succ != NULL)
+    {
+        SET_PRED(succ, pred);
+    }
+    if (pred != NULL)
+    {
+        SET_SUCC(pred, succ);
+    }
+    else
+    {
+        // 리스트의 head를 제거하는 경우
+        ar->free_lists[fl][sl] = succ;
+        if (succ == NULL)
+        {
+            // 리스트가 비면 비트맵 정리
+            ar->sl_bitmap[fl] &= ~(1U << sl);
+            if (ar->sl_bitmap[fl] == 0)
+            {
+                ar->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+}
+
+/*
+ * tree_compare - Order the key (size, addr) against the free block bp.
+ *     Blocks are ordered by size, then by address, so every key is unique.
+ */
+static int tree_compare(size_t size, char *addr, char *bp)
+{
+    size_t bp_size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+
+    if (size != bp_size)
+    {
+        return (size < bp_size) ? -1 : 1;
+    }
+    if (addr != bp)
+    {
+        return (addr < bp) ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * tree_rotate_left - Rotate the subtree rooted at x to the left.
+ */
+static void tree_rotate_left(arena_t *ar, char *x)
+{
+    char *y = TREE_RIGHT(x);
+    char *parent = TREE_PARENT(x);
+
+    SET_RIGHT(x, TREE_LEFT(y));
+    if (TREE_LEFT(y) != NULL)
+    {
+        SET_PARENT(TREE_LEFT(y), x);
+    }
+    SET_PARENT(y, parent);
+    if (parent == NULL)
+    {
+        ar->large_root = y;
+    }
+    else if (x == TREE_LEFT(parent))
+    {
+        SET_LEFT(parent, y);
+    }
+    else
+    {
+        SET_RIGHT(parent, y);
+    }
+    SET_LEFT(y, x);
+    SET_PARENT(x, y);
+}
+
+/*
+ * tree_rotate_right - Rotate the subtree rooted at x to the right.
+ */
+static void tree_rotate_right(arena_t *ar, char *x)
+{
+    char *y = TREE_LEFT(x);
+    char *parent = TREE_PARENT(x);
+
+    SET_LEFT(x, TREE_RIGHT(y));
+    if (TREE_RIGHT(y) != NULL)
+    {
+        SET_PARENT(TREE_RIGHT(y), x);
+    }
+    SET_PARENT(y, parent);
+    if (parent == NULL)
+    {
+        ar->large_root = y;
+    }
+    else if (x == TREE_RIGHT(parent))
+    {
+        SET_RIGHT(parent, y);
+    }
+    else
+    {
+        SET_LEFT(parent, y);
+    }
+    SET_RIGHT(y, x);
+    SET_PARENT(x, y);
+}
+
+/*
+ * tree_transplant - Put the subtree v where the subtree u hangs.
+ */
+static void tree_transplant(arena_t *ar, char *u, char *v)
+{
+    char *parent = TREE_PARENT(u);
+
+    if (parent == NULL)
+    {
+        ar->large_root = v;
+    }
+    else if (u == TREE_LEFT(parent))
+    {
+        SET_LEFT(parent, v);
+    }
+    else
+    {
+        SET_RIGHT(parent, v);
+    }
+    if (v != NULL)
+    {
+        SET_PARENT(v, parent);
+    }
+}
+
+/*
+ * tree_insert - Add the free block bp to the large-block tree and
+ *     restore the red-black properties.
+ */
+static void tree_insert(arena_t *ar, char *bp)
+{
+    size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+    char *parent = NULL;
+    char *x = ar->large_root;
+    char *grand, *uncle;
+
+    // 일반 BST 삽입 위치 탐색
+    while (x != NULL)
+    {
+        parent = x;
+        x = (tree_compare(size, bp, x) < 0) ? TREE_LEFT(x) : TREE_RIGHT(x);
+    }
+    SET_LEFT(bp, NULL);
+    SET_RIGHT(bp, NULL);
+    PUT_WORD(PARENT_WORD(bp), PTR_TO_OFFSET(parent) | 0x1); // 새 노드는 red
+    if (parent == NULL)
+    {
+        ar->large_root = bp;
+    }
+    else if (tree_compare(size, bp, parent) < 0)
+    {
+        SET_LEFT(parent, bp);
+    }
+    else
+    {
+        SET_RIGHT(parent, bp);
+    }
+
+    // red 노드가 연속되지 않도록 위로 올라가며 수정
+    while ((parent = TREE_PARENT(bp)) != NULL && IS_RED(parent))
+    {
+        grand = TREE_PARENT(parent);
+        if (parent == TREE_LEFT(grand))
+        {
+            uncle = TREE_RIGHT(grand);
+            if (IS_RED(uncle))
+            {
+                // 삼촌이 red: 색만 바꾸고 조부모에서 계속
+                SET_BLACK(parent);
+                SET_BLACK(uncle);
+                SET_RED(grand);
+                bp = grand;
+                continue;
+            }
+            if (bp == TREE_RIGHT(parent))
+            {
+                // 꺾인 모양은 먼저 일자로 펴기
+                bp = parent;
+                tree_rotate_left(ar, bp);
+                parent = TREE_PARENT(bp);
+            }
+            SET_BLACK(parent);
+            SET_RED(grand);
+            tree_rotate_right(ar, grand);
+        }
+        else
+        {
+            uncle = TREE_LEFT(grand);
+            if (IS_RED(uncle))
+            {
+                SET_BLACK(parent);
+                SET_BLACK(uncle);
+                SET_RED(grand);
+                bp = grand;
+                continue;
+            }
+            if (bp == TREE_LEFT(parent))
+            {
+                bp = parent;
+                tree_rotate_right(ar, bp);
+                parent = TREE_PARENT(bp);
+            }
+            SET_BLACK(parent);
+            SET_RED(grand);
+            tree_rotate_left(ar, grand);
+        }
+    }
+    SET_BLACK(ar->large_root);
+}
+
+/*
+ * tree_remove - Take the free block bp out of the large-block tree and
+ *     restore the red-black properties.
+ */
+static void tree_remove(arena_t *ar, char *bp)
+{
+    char *y = bp;
+    char *x, *x_parent, *w;
+    int removed_red = IS_RED(y);
+
+    if (TREE_LEFT(bp) == NULL)
+    {
+        x = TREE_RIGHT(bp);
+        x_parent = TREE_PARENT(bp);
+        tree_transplant(ar, bp, x);
+    }
+    else if (TREE_RIGHT(bp) == NULL)
+    {
+        x = TREE_LEFT(bp);
+        x_parent = TREE_PARENT(bp);
+        tree_transplant(ar, bp, x);
+    }
+    else
+    {
+        // 자식이 둘이면 오른쪽 서브트리의 최솟값 y가 bp 자리를 대신함
+        for (y = TREE_RIGHT(bp); TREE_LEFT(y) != NULL; y = TREE_LEFT(y))
+            ;
+        removed_red = IS_RED(y);
+        x = TREE_RIGHT(y);
+        if (TREE_PARENT(y) == bp)
+        {
+            x_parent = y;
+        }
+        else
+        {
+            x_parent = TREE_PARENT(y);
+            tree_transplant(ar, y, x);
+            SET_RIGHT(y, TREE_RIGHT(bp));
+            SET_PARENT(TREE_RIGHT(y), y);
+        }
+        tree_transplant(ar, bp, y);
+        SET_LEFT(y, TREE_LEFT(bp));
+        SET_PARENT(TREE_LEFT(y), y);
+        if (IS_RED(bp))
+        {
+            SET_RED(y);
+        }
+        else
+        {
+            SET_BLACK(y);
+        }
+    }
+
+    if (removed_red)
+    {
+        return;
+    }
+
+    // black 노드가 빠져 생긴 black 높이 부족을 위로 올라가며 수정
+    while (x != ar->large_root && !IS_RED(x))
+    {
+        if (x == TREE_LEFT(x_parent))
+        {
+            w = TREE_RIGHT(x_parent);
+            if (IS_RED(w))
+            {
+                SET_BLACK(w);
+                SET_RED(x_parent);
+                tree_rotate_left(ar, x_parent);
+                w = TREE_RIGHT(x_parent);
+            }
+            if (!IS_RED(TREE_LEFT(w)) && !IS_RED(TREE_RIGHT(w)))
+            {
+                SET_RED(w);
+                x = x_parent;
+                x_parent = TREE_PARENT(x);
+                continue;
+            }
+            if (!IS_RED(TREE_RIGHT(w)))
+            {
+                SET_BLACK(TREE_LEFT(w));
+                SET_RED(w);
+                tree_rotate_right(ar, w);
+                w = TREE_RIGHT(x_parent);
+            }
+            if (IS_RED(x_parent))
+            {
+                SET_RED(w);
+            }
+            else
+            {
+                SET_BLACK(w);
+            }
+            SET_BLACK(x_parent);
+            SET_BLACK(TREE_RIGHT(w));
+            tree_rotate_left(ar, x_parent);
+        }
+        else
+        {
+            w = TREE_LEFT(x_parent);
+            if (IS_RED(w))
+            {
+                SET_BLACK(w);
+                SET_RED(x_parent);
+                tree_rotate_right(ar, x_parent);
+                w = TREE_LEFT(x_parent);
+            }
+            if (!IS_RED(TREE_LEFT(w)) && !IS_RED(TREE_RIGHT(w)))
+            {
+                SET_RED(w);
+                x = x_parent;
+                x_parent = TREE_PARENT(x);
+                continue;
+            }
+            if (!IS_RED(TREE_LEFT(w)))
+            {
+                SET_BLACK(TREE_RIGHT(w));
+                SET_RED(w);
+                tree_rotate_left(ar, w);
+                w = TREE_LEFT(x_parent);
+            }
+            if (IS_RED(x_parent))
+            {
+                SET_RED(w);
+            }
+            else
+            {
+                SET_BLACK(w);
+            }
+            SET_BLACK(x_parent);
+            SET_BLACK(TREE_LEFT(w));
+            tree_rotate_right(ar, x_parent);
+        }
+        x = ar->large_root;
+    }
+    if (x != NULL)
+    {
+        SET_BLACK(x);
+    }
+}
+
+#if !MM_FIT_WALKS
+/*
+ * tree_best_fit - Return the smallest large free block of at least size
+ *     bytes, the lowest-addressed one among equals, or NULL.
+ */
+static char *tree_best_fit(arena_t *ar, size_t size)
+{
+    char *bp = ar->large_root;
+    char *best = NULL;
+
+    // 크기가 충분한 노드를 만나면 후보로 기록하고 더 작은 쪽(왼쪽)으로
+    while (bp != NULL)
+    {
+        STAT_VISIT(ar);
+        if (GET_BLOCK_SIZE(HEADER_PTR(bp)) >= size)
+        {
+            best = bp;
+            bp = TREE_LEFT(bp);
+        }
+        else
+        {
+            bp = TREE_RIGHT(bp);
+        }
+    }
+    return best;
+}
+#endif
+
+
+/*
+ * aligned_block - Allocate a block of asize bytes whose payload address
+ *     is a multiple of align. The slack in front of the aligned payload
+ *     is split off as a free block. The heap base is page aligned, so
+ *     slab runs are aligned relative to it as well.
+ */
+static void *aligned_block(arena_t *ar, size_t align, size_t asize)
+{
+    char *bp;
+    char *aligned_bp = NULL;
+    char *end;
+
+    // 1. 요청 크기만큼 맞는 블록이 마침 정렬 조건도 만족하는지 확인
+    bp = fit_finder(ar, asize);
+    if (bp != NULL)
+    {
+        aligned_bp = align_in_block(bp, align, asize);
+    }
+
+    // 2. 정렬 여유분까지 포함한 크기로 다시 탐색 (항상 정렬 위치를 포함)
+    if (aligned_bp == NULL && (bp = fit_finder(ar, asize + align + MIN_BLOCK_SIZE)) != NULL)
+    {
+        aligned_bp = align_in_block(bp, align, asize);
+    }
+
+    // 3. arena 끝에서 정렬된 블록이 들어갈 만큼만 확장 (끝의 free 블록과 병합됨)
+    if (aligned_bp == NULL && (end = ar->heap_end) != NULL)
+    {
+        bp = GET_PREV_ALLOC(HEADER_PTR(end)) ? end : PREVIOUS_BLOCK_PTR(end);
+        aligned_bp = (char *)(((uintptr_t)bp + align - 1) & ~(uintptr_t)(align - 1));
+        if (aligned_bp != bp && (size_t)(aligned_bp - bp) < MIN_BLOCK_SIZE)
+        {
+            aligned_bp += align;
+        }
+        if (aligned_bp + asize > end && (bp = heap_extender(ar, (aligned_bp + asize - bp) / WORD_SIZE)) == NULL)
+        {
+            return NULL;
+        }
+
+        // 다른 arena가 먼저 확장해 새 segment가 생겼으면 정렬 위치를 다시 계산
+        aligned_bp = align_in_block(bp, align, asize);
+    }
+
+    // 4. 끝에 붙여 확장할 수 없으면 정렬 여유분까지 포함해 확장
+    if (aligned_bp == NULL)
+    {
+        if ((bp = heap_extender(ar, (asize + align + MIN_BLOCK_SIZE) / WORD_SIZE)) == NULL)
+        {
+            return NULL;
+        }
+        aligned_bp = align_in_block(bp, align, asize);
+    }
+
+    if (aligned_bp != bp)
+    {
+        // 앞쪽 조각을 별도의 free 블록으로 분리
+        size_t size = GET_BLOCK_SIZE(HEADER_PTR(bp));
+        size_t lead = aligned_bp - bp;
+
+        remove_free_block(ar, bp);
+        PUT_WORD(HEADER_PTR(bp), PACK_BLOCK(lead, 0) | PREV_ALLOC);
+        PUT_WORD(FOOTER_PTR(bp), PACK_BLOCK(lead, 0));
+        PUT_WORD(HEADER_PTR(aligned_bp), PACK_BLOCK(size - lead, 0));
+        PUT_WORD(FOOTER_PTR(aligned_bp), PACK_BLOCK(size - lead, 0));
+        insert_free_block(ar, bp);
+        insert_free_block(ar, aligned_bp);
+    }
+
+    // 정렬된 위치에 블록 배치 (뒤쪽 남는 공간은 placer가 분리)
+    placer(ar, aligned_bp, asize);
+    return aligned_bp;
+}
+
+/*
+ * align_in_block - Return the first payload address inside the free
+ *     block bp that is aligned to align, leaves either no slack or a
+ *     whole free block in front, and still has room for asize bytes.
+ *     Returns NULL when the block cannot host such a payload.
+ */
+static char *align_in_block(char *bp, size_t align, size_t asize)
+{
+    char *aligned_bp = (char *)(((uintptr_t)bp + align - 1) & ~(uintptr_t)(align - 1));
+
+    if (aligned_bp != bp && (size_t)(aligned_bp - bp) < MIN_BLOCK_SIZE)
+    {
+        aligned_bp += align;
+    }
+    if (aligned_bp + asize > bp + GET_BLOCK_SIZE(HEADER_PTR(bp)))
+    {
+        return NULL;
+    }
+    return aligned_bp;
+}
+
+
+/*
+ * slab_class - Map a request of at most SLAB_MAX_SIZE bytes to the
+ *     smallest slab class that holds it.
+ */
+static int slab_class(size_t size)
+{
+#if ALIGNMENT == 16
+    return (int)((size + 15) >> 4) - 1;                    // 16바이트 간격: 0..15
+#else
+    if (size <= 64)
+    {
+        return (int)((size + 7) >> 3) - 1;                 // 8바이트 간격: 0..7
+    }
+    if (size <= 128)
+    {
+        return 8 + (int)((size - 65) >> 4);                // 16바이트 간격: 8..11
+    }
+    return 12 + (int)((size - 129) >> 5);                  // 32바이트 간격: 12..15
+#endif
+}
+
+/*
+ * slab_alloc - Take a free slot from the first partial run of the
+ *     class, carving a new run from the heap when there is none.
+ */
+static void *slab_alloc(arena_t *ar, int class_idx)
+{
+    slab_run_t *run = ar->slab_partial[class_idx];
+    unsigned int slot_size = slab_class_size[class_idx];
+    unsigned int slots, page, w;
+
+    if (run == NULL)
+    {
+        // partial run이 없으면 페이지 정렬된 새 run을 힙에서 확보
+        run = aligned_block(ar, SLAB_RUN_SIZE, SLAB_RUN_SIZE);
+        if (run == NULL)
+        {
+            return NULL;
+        }
+
+        // run 헤더 초기화: 모든 슬롯을 free로 표시
+        slots = SLAB_RUN_SLOTS(slot_size);
+        run->class_idx = class_idx;
+        run->free_count = slots;
+        run->prev = NULL;
+        run->next = NULL;
+        memset(run->bitmap, 0, sizeof(run->bitmap));
+        memset(run->bitmap, 0xff, (slots / 32) * sizeof(unsigned int));
+        if (slots % 32)
+        {
+            run->bitmap[slots / 32] = (1U << (slots % 32)) - 1;
+        }
+        ar->slab_partial[class_idx] = run;
+
+        // 페이지 맵에 run 위치 기록
+        page = SLAB_PAGE(run);
+        MAP_SET(page >> 5, 1U << (page & 31));
+    }
+
+    // 비트맵에서 첫 번째 free 슬롯을 찾음
+    for (w = 0; run->bitmap[w] == 0; w++)
+        ;
+    unsigned int bit = __builtin_ctz(run->bitmap[w]);
+    run->bitmap[w] &= ~(1U << bit);
+    ar->small_live++;
+
+    // 마지막 슬롯을 내주면 partial 리스트에서 제거
+    if (--run->free_count == 0)
+    {
+        ar->slab_partial[class_idx] = run->next;
+        if (run->next != NULL)
+        {
+            run->next->prev = NULL;
+        }
+    }
+
+    return (char *)run + SLAB_FIRST_SLOT + (w * 32 + bit) * slot_size;
+}
+
+/*
+ * slab_free - Return a slot to its run. A run that becomes empty is
+ *     handed back to the boundary-tag heap unless it is the only partial
+ *     run of its class, which keeps alloc/free pairs from thrashing.
+ */
+static void slab_free(arena_t *ar, void *ptr)
+{
+    slab_run_t *run = SLAB_RUN_PTR(ptr);
+    int class_idx = run->class_idx;
+    unsigned int slot_size = slab_class_size[class_idx];
+    unsigned int slots = SLAB_RUN_SLOTS(slot_size);
+    unsigned int idx = ((char *)ptr - (char *)run - SLAB_FIRST_SLOT) / slot_size;
+    unsigned int page;
+
+    run->bitmap[idx / 32] |= 1U << (idx % 32);
+    ar->small_live--;
+
+    // 가득 찼던 run은 다시 partial 리스트 맨 앞에 등록
+    if (run->free_count++ == 0)
+    {
+        run->prev = NULL;
+        run->next = ar->slab_partial[class_idx];
+        if (run->next != NULL)
+        {
+            run->next->prev = run;
+        }
+        ar->slab_partial[class_idx] = run;
+    }
+
+    // 완전히 빈 run은 다른 partial run이 있을 때만 힙에 반환
+    if (run->free_count == slots && (run->prev != NULL || run->next != NULL))
+    {
+        if (run->prev != NULL)
+        {
+            run->prev->next = run->next;
+        }
+        else
+        {
+            ar->slab_partial[class_idx] = run->next;
+        }
+        if (run->next != NULL)
+        {
+            run->next->prev = run->prev;
+        }
+
+        page = SLAB_PAGE(run);
+        MAP_CLEAR(page >> 5, 1U << (page & 31));
+        arena_free(ar, run);
+    }
+}
+
+
+#ifdef MM_THREADS
+/*
+ * tcache_reset - Empty the calling thread's cache after mm_init started
+ *     a new heap, and register it for flushing at thread exit.
+ */
+static void tcache_reset(void)
+{
+    memset(&tcache, 0, sizeof(tcache));
+    tcache.generation = heap_generation;
+    pthread_setspecific(tcache_key, &tcache);
+}
+
+/*
+ * tcache_flush - Thread exit destructor: give every cached block back
+ *     to the arena that owns it.
+ */
+static void tcache_flush(void *unused)
+{
+    int i;
+    void *bp;
+    arena_t *ar;
+
+    // pool magazine은 pool 세대로 따로 확인
+    for (i = 0; i < POOL_MAGAZINE_SLOTS; i++)
+    {
+        if (pool_magazines[i].pool != NULL)
+        {
+            magazine_flusher(&pool_magazines[i]);
+        }
+    }
+
+    // 이전 힙의 블록이면 이미 무효이므로 버림
+    if (tcache.generation != heap_generation)
+    {
+        return;
+    }
+    for (i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        while ((bp = tcache.bins[i]) != NULL)
+        {
+            tcache.bins[i] = *(void **)bp;
+            ar = arena_of(bp);
+            ARENA_LOCK(ar);
+            arena_free(ar, bp);
+            ARENA_UNLOCK(ar);
+        }
+        tcache.counts[i] = 0;
+    }
+}
+
+/*
+ * tcache_create_key - Create the key whose destructor flushes a
+ *     thread's cache when the thread exits.
+ */
+static void tcache_create_key(void)
+{
+    pthread_key_create(&tcache_key, tcache_flush);
+}
+#endif
@@ -4,6 +4,103 @@ extern int mm_init (void);
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+extern void *mm_calloc(size_t nmemb, size_t size);
+extern void *mm_memalign(size_t alignment, size_t size);
+extern void *mm_aligned_alloc(size_t alignment, size_t size);
+extern size_t mm_malloc_usable_size(void *ptr);
+extern size_t mm_malloc_batch(size_t size, size_t n, void **out);
+extern void mm_free_sized(void *ptr, size_t size);
+extern void mm_free_batch(void **ptrs, size_t n);
+
+/* Region arenas: bump allocation, everything freed at once */
+typedef struct mm_arena mm_arena_t;
+extern mm_arena_t *mm_arena_create(size_t chunk_size);
+extern void *mm_arena_alloc(mm_arena_t *arena, size_t size);
+extern void mm_arena_reset(mm_arena_t *arena);
+extern void mm_arena_destroy(mm_arena_t *arena);
+
+/* Fixed-size object pools, safe to free from any thread */
+typedef struct mm_pool mm_pool_t;
+extern mm_pool_t *mm_pool_create(size_t obj_size);
+extern void *mm_pool_alloc(mm_pool_t *pool);
+extern void mm_pool_free(mm_pool_t *pool, void *obj);
+extern void mm_pool_destroy(mm_pool_t *pool);
+
+/* Movable blocks reached through handles; mm_compact slides unpinned ones */
+typedef unsigned int mm_handle_t;
+extern mm_handle_t mm_halloc(size_t size);
+extern int mm_hrealloc(mm_handle_t handle, size_t size);
+extern void *mm_hlock(mm_handle_t handle);
+extern void mm_hunlock(mm_handle_t handle);
+extern void mm_hfree(mm_handle_t handle);
+extern size_t mm_compact(void);
+
+extern int mm_setopt(int option, size_t value);
+extern size_t mm_copy_bytes(void);
+extern int mm_check(int level);
+extern void mm_fork_lock(void);
+extern void mm_fork_unlock(void);
+
+/*
+ * Telemetry, counted only when mm.c is built with -DMM_STATS. Bucket b
+ * of a histogram counts the values v with 2^(b-1) <= v < 2^b (bucket 0
+ * counts v = 0, the last bucket everything above).
+ */
+#define MM_STATS_BUCKETS 32
+typedef struct {
+    unsigned long mallocs;         /* malloc, calloc and memalign requests */
+    unsigned long frees;           /* free requests */
+    unsigned long reallocs;        /* realloc requests */
+    unsigned long tcache_hits;     /* requests served by the thread cache */
+    unsigned long slab_allocs;     /* requests served by a slab run */
+    unsigned long mmap_allocs;     /* requests given a mapping of their own */
+    unsigned long searches;        /* free index searches */
+    unsigned long search_misses;   /* searches that found no block */
+    unsigned long search_visits;   /* blocks looked at by all searches */
+    unsigned long splits;          /* placements that split off a remainder */
+    unsigned long whole_fits;      /* placements that took the whole block */
+    unsigned long coalesce[4];     /* frees merging with no neighbour, the
+                                      next, the previous and both */
+    unsigned long realloc_shrinks; /* reallocs that shrank in place */
+    unsigned long realloc_grows;   /* reallocs that grew in place */
+    unsigned long realloc_slides;  /* reallocs moved down into a free
+                                      predecessor (memmove) */
+    unsigned long realloc_copies;  /* reallocs that fell back to a new
+                                      block and memcpy */
+    unsigned long heap_extends;    /* mem_sbrk calls growing the heap */
+    unsigned long heap_trims;      /* mem_sbrk calls shrinking the heap */
+    unsigned long size_hist[MM_STATS_BUCKETS];   /* requests by size */
+    unsigned long search_hist[MM_STATS_BUCKETS]; /* searches by blocks
+                                                    looked at */
+} mm_stats_t;
+extern int mm_stats(mm_stats_t *stats);
+
+/*
+ * Tunable parameters for mm_setopt. They keep their values across
+ * mm_init calls.
+ */
+#define MM_TRIM_THRESHOLD 1  /* trim a free heap top above this size (0 = never) */
+#define MM_TOP_PAD        2  /* bytes of free heap top left after a trim */
+#define MM_MMAP_THRESHOLD 3  /* map requests of at least this size (0 = never) */
+#define MM_GROW_POLICY    4  /* how the heap grows, one of MM_GROW_* below */
+#define MM_GROW_CAP       5  /* largest step of MM_GROW_GEOMETRIC in bytes */
+#define MM_CHECK_LEVEL    6  /* checks the calls run themselves, one of MM_CHECK_* */
+#define MM_CHECK_INTERVAL 7  /* calls between full walks of MM_CHECK_SAMPLED */
+
+/* Heap growth policies for MM_GROW_POLICY */
+#define MM_GROW_EXACT     0  /* extend by the full request */
+#define MM_GROW_SHORTFALL 1  /* extend by what a free heap top lacks */
+#define MM_GROW_GEOMETRIC 2  /* like SHORTFALL, in doubling steps up to the cap */
+
+/*
+ * Heap check levels, for mm_check and MM_CHECK_LEVEL. mm_check returns
+ * 0, or prints the first problem to stderr and returns -1; with
+ * MM_CHECK_LEVEL set, malloc, free and realloc abort on it instead.
+ */
+#define MM_CHECK_OFF      0  /* no checks */
+#define MM_CHECK_BLOCK    1  /* O(1) checks of the block a call is handed or returns */
+#define MM_CHECK_HEAP     2  /* block checks, plus a walk of every block and free list per call */
+#define MM_CHECK_SAMPLED  3  /* block checks, plus the walk every MM_CHECK_INTERVAL calls */
 
 
 /* 
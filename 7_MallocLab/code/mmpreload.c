@@ -0,0 +1,235 @@
+/*
+ * mmpreload.c - Runs mm.c as the malloc of an unmodified program:
+ *
+ *     unix> make libmm.so
+ *     unix> LD_PRELOAD=./libmm.so sort big.txt
+ *
+ * The library is the thread-safe 64-bit build of mm.c over memlib,
+ * exporting the libc allocation functions. Only these wrappers are
+ * visible; everything else in mm.c and memlib.c is hidden so it cannot
+ * clash with the program's own symbols.
+ *
+ * The heap is set up by the first call rather than by a constructor,
+ * since the dynamic loader and libc may allocate before any constructor
+ * runs. Setting it up makes no allocations, but registering the fork
+ * handlers can; calls the initializing thread makes meanwhile are
+ * served from a small static bootstrap buffer whose blocks are never
+ * reused. Other threads wait until the heap is ready.
+ *
+ * Fork safety comes from pthread_atfork handlers that take every
+ * allocator lock before the fork and release them in both processes
+ * afterwards, so the child never inherits a lock held by a thread that
+ * does not exist there.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define EXPORT __attribute__((visibility("default")))
+
+/* Misc */
+#define PRELOAD_HEAP   (1ULL<<32) /* heap reservation, the most mm.c can address */
+#define BOOTSTRAP_SIZE (64*1024)  /* static buffer for calls made during setup */
+#define BOOTSTRAP_ALIGN 16        /* payload alignment of bootstrap blocks */
+
+/* Heap states */
+#define HEAP_NONE  0  /* nobody has started setting up the heap */
+#define HEAP_BUSY  1  /* a thread is setting it up */
+#define HEAP_READY 2  /* mm.c serves every call */
+
+static int heap_state = HEAP_NONE;
+static __thread int heap_initializer; /* set in the thread setting up the heap */
+
+/* Bootstrap buffer; each block is preceded by its size */
+static char bootstrap[BOOTSTRAP_SIZE] __attribute__((aligned(BOOTSTRAP_ALIGN)));
+static size_t bootstrap_used;
+
+#define IS_BOOTSTRAP(p) ((char *)(p) >= bootstrap && \
+			 (char *)(p) < bootstrap + BOOTSTRAP_SIZE)
+#define BOOTSTRAP_SIZEOF(p) (*(size_t *)((char *)(p) - BOOTSTRAP_ALIGN))
+
+/*
+ * heap_ready - set up memlib and mm.c on the first call; returns 0 if
+ *     the caller is the thread doing so and must use the bootstrap buffer
+ */
+static int heap_ready(void)
+{
+    int expected = HEAP_NONE;
+
+    if (__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) == HEAP_READY)
+	return 1;
+    if (heap_initializer)
+	return 0;
+    if (__atomic_compare_exchange_n(&heap_state, &expected, HEAP_BUSY, 0,
+				    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+	heap_initializer = 1;
+	mem_set_maxheap(PRELOAD_HEAP);
+	mem_init();
+	if (mm_init() < 0) {
+	    fprintf(stderr, "libmm: mm_init failed\n");
+	    abort();
+	}
+	pthread_atfork(mm_fork_lock, mm_fork_unlock, mm_fork_unlock);
+	heap_initializer = 0;
+	__atomic_store_n(&heap_state, HEAP_READY, __ATOMIC_RELEASE);
+	return 1;
+    }
+
+    /* Another thread is setting the heap up; it makes no calls back to us */
+    while (__atomic_load_n(&heap_state, __ATOMIC_ACQUIRE) != HEAP_READY)
+	sched_yield();
+    return 1;
+}
+
+/*
+ * bootstrap_alloc - carve size bytes from the bootstrap buffer
+ */
+static void *bootstrap_alloc(size_t size)
+{
+    size_t need, offset;
+
+    if (size > BOOTSTRAP_SIZE)
+	return NULL;
+    need = BOOTSTRAP_ALIGN + ((size + BOOTSTRAP_ALIGN - 1) & ~(size_t)(BOOTSTRAP_ALIGN - 1));
+    offset = __atomic_fetch_add(&bootstrap_used, need, __ATOMIC_RELAXED);
+    if (offset + need > BOOTSTRAP_SIZE)
+	return NULL;
+    *(size_t *)(bootstrap + offset) = size;
+    return bootstrap + offset + BOOTSTRAP_ALIGN;
+}
+
+EXPORT void *malloc(size_t size)
+{
+    void *ptr;
+
+    if (!heap_ready())
+	ptr = bootstrap_alloc(size);
+    else
+	ptr = mm_malloc(size ? size : 1); /* malloc(0) must be unique */
+    if (ptr == NULL)
+	errno = ENOMEM;
+    return ptr;
+}
+
+EXPORT void free(void *ptr)
+{
+    if (ptr == NULL || IS_BOOTSTRAP(ptr))
+	return;
+    mm_free(ptr);
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && nmemb > (size_t)-1 / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if (!heap_ready())
+	ptr = bootstrap_alloc(nmemb * size); /* static memory is zero */
+    else if (nmemb * size == 0)
+	ptr = mm_calloc(1, 1);
+    else
+	ptr = mm_calloc(nmemb, size);
+    if (ptr == NULL)
+	errno = ENOMEM;
+    return ptr;
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+    size_t old_size;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+
+    /* Bootstrap blocks move into the heap once it is there */
+    if (IS_BOOTSTRAP(ptr)) {
+	if ((new_ptr = malloc(size)) == NULL)
+	    return NULL;
+	old_size = BOOTSTRAP_SIZEOF(ptr);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	return new_ptr;
+    }
+    if ((new_ptr = mm_realloc(ptr, size)) == NULL)
+	errno = ENOMEM;
+    return new_ptr;
+}
+
+EXPORT void *memalign(size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+	errno = EINVAL;
+	return NULL;
+    }
+    if (!heap_ready()) {
+	/* Over-allocate and keep the size word right below the payload */
+	if (size > (size_t)-1 - alignment ||
+	    (ptr = bootstrap_alloc(size + alignment)) == NULL) {
+	    errno = ENOMEM;
+	    return NULL;
+	}
+	ptr = (void *)(((size_t)ptr + alignment - 1) & ~(alignment - 1));
+	BOOTSTRAP_SIZEOF(ptr) = size;
+	return ptr;
+    }
+    if ((ptr = mm_memalign(alignment, size ? size : 1)) == NULL)
+	errno = ENOMEM;
+    return ptr;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (alignment == 0 || alignment % sizeof(void *) != 0 || 
+	(alignment & (alignment - 1)) != 0)
+	return EINVAL;
+    if ((ptr = memalign(alignment, size)) == NULL)
+	return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+EXPORT void *valloc(size_t size)
+{
+    return memalign(mem_pagesize(), size);
+}
+
+EXPORT void *pvalloc(size_t size)
+{
+    size_t pagesize = mem_pagesize();
+
+    /* Rounding up to whole pages must not wrap to a small size */
+    if (size > (size_t)-1 - pagesize) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    return memalign(pagesize, (size + pagesize - 1) & ~(pagesize - 1));
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+    if (ptr != NULL && IS_BOOTSTRAP(ptr))
+	return BOOTSTRAP_SIZEOF(ptr);
+    return mm_malloc_usable_size(ptr);
+}
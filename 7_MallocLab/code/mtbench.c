@@ -0,0 +1,245 @@
+/*
+ * mtbench.c - Multi-threaded scalability benchmark for the thread-safe
+ *     build of mm.c (compiled with -DMM_THREADS).
+ *
+ * Each thread owns a window of slots and repeatedly frees a random
+ * slot and refills it with a block of random size. Every HANDOFF_RATE
+ * operations a thread passes one of its blocks to the next thread,
+ * which frees it, so frees that land in another thread's arena are
+ * exercised as well. The same workload is run against mm.c and libc
+ * malloc at 1, 2, 4 and 8 threads and the throughput is reported in
+ * operations (malloc or free) per second.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "ftimer.h"
+
+/* Misc */
+#define MAXTHREADS   8   /* largest thread count that is measured */
+#define HANDOFF_RATE 64  /* ops between two blocks handed to the next thread */
+#define MAILBOX_SIZE 256 /* pending handed-off blocks per thread */
+#define BENCH_HEAP   (1<<30) /* heap reservation shared by all threads */
+
+/* An allocator under test */
+typedef struct {
+    char *name;
+    void *(*malloc_fn)(size_t size);
+    void (*free_fn)(void *ptr);
+} allocator_t;
+
+/* Blocks handed to a thread by its neighbour, freed by the owner */
+typedef struct {
+    pthread_mutex_t lock;
+    void *blocks[MAILBOX_SIZE];
+    int count;
+} mailbox_t;
+
+/* Per-thread parameters */
+typedef struct {
+    int id;
+    int nthreads;
+    allocator_t *alloc;
+} worker_t;
+
+/* Parameters of one timed run, passed through ftimer */
+typedef struct {
+    int nthreads;
+    allocator_t *alloc;
+} run_t;
+
+/* Global workload parameters (set from the command line) */
+static int num_ops = 1000000; /* ops per thread */
+static int num_slots = 1000;  /* live blocks per thread */
+static int max_size = 512;    /* largest request in bytes */
+
+static mailbox_t mailboxes[MAXTHREADS];
+
+static void *libc_malloc(size_t size) { return malloc(size); }
+static void libc_free(void *ptr) { free(ptr); }
+
+static allocator_t allocators[] = {
+    {"mm", mm_malloc, mm_free},
+    {"libc", libc_malloc, libc_free},
+};
+
+/*
+ * next_random - xorshift generator, one state per thread
+ */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/*
+ * drain_mailbox - free every block other threads handed to thread id
+ */
+static void drain_mailbox(int id, allocator_t *alloc)
+{
+    mailbox_t *box = &mailboxes[id];
+    void *blocks[MAILBOX_SIZE];
+    int i, n;
+
+    pthread_mutex_lock(&box->lock);
+    n = box->count;
+    memcpy(blocks, box->blocks, n * sizeof(void *));
+    box->count = 0;
+    pthread_mutex_unlock(&box->lock);
+
+    for (i = 0; i < n; i++)
+	alloc->free_fn(blocks[i]);
+}
+
+/*
+ * worker - the per-thread alloc/free loop
+ */
+static void *worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    allocator_t *alloc = w->alloc;
+    mailbox_t *next = &mailboxes[(w->id + 1) % w->nthreads];
+    unsigned int seed = 2463534242u + w->id * 7919;
+    void **slots;
+    int i, k;
+
+    if ((slots = calloc(num_slots, sizeof(void *))) == NULL) {
+	fprintf(stderr, "mtbench: calloc failed\n");
+	exit(1);
+    }
+
+    for (i = 0; i < num_ops; i += 2) {
+	k = next_random(&seed) % num_slots;
+
+	/* Every so often hand the block to the next thread instead */
+	if (slots[k] != NULL && w->nthreads > 1 && (i % HANDOFF_RATE) == 0) {
+	    pthread_mutex_lock(&next->lock);
+	    if (next->count < MAILBOX_SIZE) {
+		next->blocks[next->count++] = slots[k];
+		slots[k] = NULL;
+	    }
+	    pthread_mutex_unlock(&next->lock);
+	    drain_mailbox(w->id, alloc);
+	}
+
+	if (slots[k] != NULL)
+	    alloc->free_fn(slots[k]);
+	if ((slots[k] = alloc->malloc_fn(1 + next_random(&seed) % max_size)) == NULL) {
+	    fprintf(stderr, "mtbench: %s malloc failed\n", alloc->name);
+	    exit(1);
+	}
+	*(char *)slots[k] = (char)i;
+    }
+
+    for (k = 0; k < num_slots; k++)
+	if (slots[k] != NULL)
+	    alloc->free_fn(slots[k]);
+    free(slots);
+    return NULL;
+}
+
+/*
+ * run_threads - start nthreads workers and wait for all of them
+ */
+static void run_threads(void *arg)
+{
+    run_t *run = (run_t *)arg;
+    pthread_t tids[MAXTHREADS];
+    worker_t workers[MAXTHREADS];
+    int i;
+
+    for (i = 0; i < run->nthreads; i++) {
+	workers[i].id = i;
+	workers[i].nthreads = run->nthreads;
+	workers[i].alloc = run->alloc;
+	if (pthread_create(&tids[i], NULL, worker, &workers[i]) != 0) {
+	    fprintf(stderr, "mtbench: pthread_create failed\n");
+	    exit(1);
+	}
+    }
+    for (i = 0; i < run->nthreads; i++)
+	pthread_join(tids[i], NULL);
+
+    /* Blocks still in a mailbox belong to nobody now */
+    for (i = 0; i < run->nthreads; i++)
+	drain_mailbox(i, run->alloc);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mtbench [-h] [-n <ops>] [-s <slots>] [-m <maxsize>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <ops>   Malloc and free calls per thread.\n");
+    fprintf(stderr, "\t-s <slots> Live blocks per thread.\n");
+    fprintf(stderr, "\t-m <size>  Largest request size in bytes.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int c, i, t;
+    run_t run;
+    double secs[2];
+
+    while ((c = getopt(argc, argv, "n:s:m:h")) != EOF) {
+	switch (c) {
+	case 'n':
+	    num_ops = atoi(optarg);
+	    break;
+	case 's':
+	    num_slots = atoi(optarg);
+	    break;
+	case 'm':
+	    max_size = atoi(optarg);
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (num_ops <= 0 || num_slots <= 0 || max_size <= 0) {
+	usage();
+	exit(1);
+    }
+
+    for (i = 0; i < MAXTHREADS; i++)
+	pthread_mutex_init(&mailboxes[i].lock, NULL);
+    mem_set_maxheap(BENCH_HEAP);
+    mem_init();
+
+    printf("%d ops/thread, %d slots/thread, sizes 1..%d\n",
+	   num_ops, num_slots, max_size);
+    printf("%7s %14s %14s %8s\n", "threads", "mm ops/s", "libc ops/s", "mm/libc");
+    for (t = 1; t <= MAXTHREADS; t *= 2) {
+	run.nthreads = t;
+	for (i = 0; i < 2; i++) {
+	    if (i == 0) {
+		mem_reset_brk();
+		if (mm_init() < 0) {
+		    fprintf(stderr, "mtbench: mm_init failed\n");
+		    exit(1);
+		}
+	    }
+	    run.alloc = &allocators[i];
+	    secs[i] = ftimer_gettod(run_threads, &run, 1);
+	}
+	printf("%7d %14.0f %14.0f %8.2f\n", t,
+	       (double)num_ops * t / secs[0], (double)num_ops * t / secs[1],
+	       secs[1] / secs[0]);
+    }
+
+    mem_deinit();
+    exit(0);
+}
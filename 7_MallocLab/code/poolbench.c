@@ -0,0 +1,278 @@
+/*
+ * poolbench.c - Producer/consumer benchmark for the fixed-size object
+ *     pool of the thread-safe build of mm.c (compiled with -DMM_THREADS).
+ *
+ * Half of the threads are producers and half are consumers, paired
+ * through single-producer/single-consumer rings. A producer allocates
+ * fixed-size messages, stamps them and passes them on; its consumer
+ * checks the stamp and frees the message, so every free happens on a
+ * thread other than the one that allocated. The same workload is run
+ * with an mm_pool_t, with mm_malloc/mm_free and with libc malloc at 2,
+ * 4 and 8 threads. Throughput is reported in operations (allocate or
+ * free) per second, and where the kernel allows it, the cache misses
+ * per operation counted by perf_event for all threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "ftimer.h"
+
+/* Misc */
+#define MAXTHREADS 8        /* largest thread count that is measured */
+#define RING_SIZE  1024     /* messages in flight per producer (power of 2) */
+#define BENCH_HEAP (1<<30)  /* heap reservation shared by all threads */
+
+/* An allocator under test; the pool one goes through the global pool */
+typedef struct {
+    char *name;
+    void *(*alloc_fn)(size_t size);
+    void (*free_fn)(void *ptr);
+} allocator_t;
+
+/* Single-producer/single-consumer ring; the indices never wrap back */
+typedef struct {
+    void *slots[RING_SIZE];
+    unsigned int tail __attribute__((aligned(64))); /* next slot to fill */
+    unsigned int head __attribute__((aligned(64))); /* next slot to drain */
+} ring_t;
+
+/* Per-thread parameters */
+typedef struct {
+    int id;
+    allocator_t *alloc;
+} worker_t;
+
+/* Parameters of one timed run, passed through ftimer */
+typedef struct {
+    int nthreads;
+    allocator_t *alloc;
+} run_t;
+
+/* Global workload parameters (set from the command line) */
+static int num_msgs = 1000000; /* messages per producer */
+static int msg_size = 64;      /* message size in bytes */
+
+static ring_t rings[MAXTHREADS / 2];
+static mm_pool_t *pool;
+
+static void *pool_alloc(size_t size) { return mm_pool_alloc(pool); }
+static void pool_free(void *ptr) { mm_pool_free(pool, ptr); }
+static void *libc_malloc(size_t size) { return malloc(size); }
+static void libc_free(void *ptr) { free(ptr); }
+
+static allocator_t allocators[] = {
+    {"pool", pool_alloc, pool_free},
+    {"mm", mm_malloc, mm_free},
+    {"libc", libc_malloc, libc_free},
+};
+#define NUM_ALLOCATORS (sizeof(allocators) / sizeof(allocators[0]))
+
+/*
+ * producer - allocate, stamp and send num_msgs messages
+ */
+static void *producer(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    ring_t *ring = &rings[w->id];
+    unsigned int tail = 0;
+    char *msg;
+    int i;
+
+    for (i = 0; i < num_msgs; i++) {
+	if ((msg = w->alloc->alloc_fn(msg_size)) == NULL) {
+	    fprintf(stderr, "poolbench: %s allocation failed\n", w->alloc->name);
+	    exit(1);
+	}
+	*(int *)msg = i;
+	msg[msg_size - 1] = (char)i;
+
+	/* Wait for room; with fewer cores than threads, let the consumer run */
+	while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == RING_SIZE)
+	    sched_yield();
+	ring->slots[tail % RING_SIZE] = msg;
+	__atomic_store_n(&ring->tail, ++tail, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/*
+ * consumer - receive, check and free num_msgs messages
+ */
+static void *consumer(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    ring_t *ring = &rings[w->id];
+    unsigned int head = 0;
+    char *msg;
+    int i;
+
+    for (i = 0; i < num_msgs; i++) {
+	while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+	    sched_yield();
+	msg = ring->slots[head % RING_SIZE];
+	__atomic_store_n(&ring->head, ++head, __ATOMIC_RELEASE);
+
+	if (*(int *)msg != i || msg[msg_size - 1] != (char)i) {
+	    fprintf(stderr, "poolbench: %s message %d was corrupted\n",
+		    w->alloc->name, i);
+	    exit(1);
+	}
+	w->alloc->free_fn(msg);
+    }
+    return NULL;
+}
+
+/*
+ * run_threads - start nthreads/2 producer/consumer pairs and wait for
+ *     all of them
+ */
+static void run_threads(void *arg)
+{
+    run_t *run = (run_t *)arg;
+    pthread_t tids[MAXTHREADS];
+    worker_t workers[MAXTHREADS];
+    int i;
+
+    for (i = 0; i < run->nthreads; i++) {
+	workers[i].id = i / 2;
+	workers[i].alloc = run->alloc;
+	if (pthread_create(&tids[i], NULL, (i % 2) ? consumer : producer,
+			   &workers[i]) != 0) {
+	    fprintf(stderr, "poolbench: pthread_create failed\n");
+	    exit(1);
+	}
+    }
+    for (i = 0; i < run->nthreads; i++)
+	pthread_join(tids[i], NULL);
+    for (i = 0; i < run->nthreads / 2; i++)
+	rings[i].head = rings[i].tail = 0;
+}
+
+/*
+ * open_counter - open a cache-miss counter for this thread and the
+ *     threads it creates from now on; returns -1 if perf_event is not
+ *     available
+ */
+static int open_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * timed_run - time one run, counting cache misses on fd if fd >= 0;
+ *     *misses is set to -1 when they could not be counted
+ */
+static double timed_run(run_t *run, int fd, long long *misses)
+{
+    double secs;
+
+    *misses = -1;
+    if (fd >= 0) {
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    secs = ftimer_gettod(run_threads, run, 1);
+    if (fd >= 0) {
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(fd, misses, sizeof(*misses)) != sizeof(*misses))
+	    *misses = -1;
+    }
+    return secs;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: poolbench [-h] [-n <msgs>] [-s <size>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <msgs>  Messages sent by each producer.\n");
+    fprintf(stderr, "\t-s <size>  Message size in bytes.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int c, t, fd;
+    unsigned int k;
+    run_t run;
+    double secs, ops;
+    long long misses;
+
+    while ((c = getopt(argc, argv, "n:s:h")) != EOF) {
+	switch (c) {
+	case 'n':
+	    num_msgs = atoi(optarg);
+	    break;
+	case 's':
+	    msg_size = atoi(optarg);
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (num_msgs <= 0 || msg_size < (int)sizeof(int)) {
+	usage();
+	exit(1);
+    }
+
+    mem_set_maxheap(BENCH_HEAP);
+    mem_init();
+    if ((fd = open_counter()) < 0)
+	printf("(cache misses not available: perf_event_open failed)\n");
+
+    printf("%d messages/producer, %d bytes each\n", num_msgs, msg_size);
+    printf("%7s", "threads");
+    for (k = 0; k < NUM_ALLOCATORS; k++)
+	printf(" %9s ops/s %7s", allocators[k].name, "miss/op");
+    printf("\n");
+    for (t = 2; t <= MAXTHREADS; t *= 2) {
+	run.nthreads = t;
+	printf("%7d", t);
+	for (k = 0; k < NUM_ALLOCATORS; k++) {
+	    /* Each mm run starts from a fresh heap */
+	    if (allocators[k].alloc_fn != libc_malloc) {
+		mem_reset_brk();
+		if (mm_init() < 0 || (pool = mm_pool_create(msg_size)) == NULL) {
+		    fprintf(stderr, "poolbench: mm_init failed\n");
+		    exit(1);
+		}
+	    }
+	    run.alloc = &allocators[k];
+	    secs = timed_run(&run, fd, &misses);
+	    ops = 2.0 * num_msgs * (t / 2);
+	    printf(" %15.0f", ops / secs);
+	    if (misses >= 0)
+		printf(" %7.2f", misses / ops);
+	    else
+		printf(" %7s", "-");
+	}
+	printf("\n");
+    }
+
+    if (fd >= 0)
+	close(fd);
+    mem_deinit();
+    exit(0);
+}
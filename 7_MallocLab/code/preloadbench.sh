@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# preloadbench.sh - Run a few standard tools with glibc malloc and with
+#     mm.c preloaded (libmm.so) and compare their wall time and peak RSS.
+#
+# Usage: ./preloadbench.sh [-n <runs>]
+#
+# Each workload is run <runs> times (3 by default) under each allocator;
+# the best wall time and the largest peak RSS (of the tool or any of its
+# children, e.g. cc1 under gcc) are reported. python3 does the timing,
+# since it can read the children's peak RSS portably, and is also one of
+# the workloads. Needs sort, gcc and python3 on the PATH.
+#
+
+RUNS=3
+if [ "$1" = "-n" ] && [ -n "$2" ]; then
+    RUNS=$2
+elif [ -n "$1" ]; then
+    echo "Usage: $0 [-n <runs>]" >&2
+    exit 1
+fi
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+LIB=$DIR/libmm.so
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+make -C "$DIR" libmm.so >/dev/null || exit 1
+
+# Inputs: 500,000 unsorted lines for sort and a Python script that builds
+# and drops dicts, strings and lists of assorted sizes
+awk 'BEGIN { for (i = 0; i < 500000; i++) printf "%d line %d\n", (i * 7919) % 1000003, i }' \
+    > "$TMP/sort.in"
+cat > "$TMP/work.py" <<'EOF'
+d = {i: str(i) * (i % 7 + 1) for i in range(400000)}
+rows = [list(range(i % 100)) for i in range(100000)]
+words = sorted(d.values(), key=len)
+for i in range(0, len(rows), 2):
+    rows[i] = None
+text = " ".join(words[:200000])
+print(len(d), len(rows), len(text))
+EOF
+
+# measure <runs> <preload or ""> <command...>: prints "<best secs> <peak KB>"
+measure()
+{
+    python3 - "$@" <<'EOF'
+import os, resource, subprocess, sys, time
+runs, preload, cmd = int(sys.argv[1]), sys.argv[2], sys.argv[3:]
+env = dict(os.environ)
+if preload:
+    env["LD_PRELOAD"] = preload
+best, peak = None, 0
+for _ in range(runs):
+    start = time.perf_counter()
+    rc = subprocess.call(cmd, env=env, stdout=subprocess.DEVNULL)
+    secs = time.perf_counter() - start
+    if rc != 0:
+        sys.exit("%s exited with %d" % (cmd[0], rc))
+    best = secs if best is None else min(best, secs)
+    # ru_maxrss of RUSAGE_CHILDREN is the largest of all children so far,
+    # which is fine as every run of a workload is alike
+    peak = max(peak, resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss)
+print("%.3f %d" % (best, peak))
+EOF
+}
+
+printf "%-8s %9s %9s %7s %10s %10s %7s\n" \
+       "workload" "glibc s" "mm s" "time" "glibc KB" "mm KB" "rss"
+run()
+{
+    name=$1
+    shift
+    set -- $(measure "$RUNS" "" "$@") $(measure "$RUNS" "$LIB" "$@")
+    [ $# -eq 4 ] || { echo "$name: failed" >&2; return; }
+    awk -v n="$name" -v gs="$1" -v gk="$2" -v ms="$3" -v mk="$4" 'BEGIN {
+        printf "%-8s %9.3f %9.3f %6.2fx %10d %10d %6.2fx\n",
+               n, gs, ms, ms / gs, gk, mk, mk / gk }'
+}
+
+run sort sort "$TMP/sort.in" -o "$TMP/sort.out"
+run gcc gcc -O2 -c "$DIR/mm.c" -o "$TMP/mm.o"
+run python python3 "$TMP/work.py"
@@ -49,6 +49,13 @@ $summary = $opt_s;
 #
 %HASH = (); 
 
+#
+# ARENA holds the live ids of each open arena (created by an n
+# request); a reset (z) or destroy (d) frees all of them at once.
+#
+%ARENA = ();
+%INARENA = ();
+
 # Read the trace header values
 $heap_size = <STDIN>;
 chomp($heap_size);
@@ -81,14 +88,65 @@ while ($line = <STDIN>) {
     # save the line for output later
     $lines[$requestnum++] = $line;
 
-    #ignore realloc requests, as long as they are preceeded by an alloc request
-    if ($cmd eq "r") {
+    #ignore realloc and usable-size requests, as long as they are
+    #preceeded by an alloc request
+    if ($cmd eq "r" or $cmd eq "u") {
 	if (!$HASH{$id}) {
 	    die "$0: ERROR[$linenum]: realloc without previous alloc\n";
 	}
 	next;
     }
 
+    #calloc and memalign requests allocate just like malloc, and a
+    #sized free frees like free
+    if ($cmd eq "c" or $cmd eq "m") {
+	$cmd = "a";
+    }
+    if ($cmd eq "s") {
+	$cmd = "f";
+    }
+
+    #a batch request allocates or frees <size> consecutive ids
+    @ids = ($id);
+    if ($cmd eq "b" or $cmd eq "x") {
+	@ids = ($id .. $id + $size - 1);
+	$cmd = ($cmd eq "b") ? "a" : "f";
+    }
+
+    #arena requests: n creates arena <id>, g allocates <id> from arena
+    #<size>, and z or d frees everything allocated from arena <id>
+    $arena_free = 0;
+    if ($cmd eq "n") {
+	if (exists($ARENA{$id})) {
+	    die "$0: ERROR[$linenum]: arena $id created twice.\n";
+	}
+	$ARENA{$id} = [];
+	next;
+    }
+    if ($cmd eq "g") {
+	if (!exists($ARENA{$size})) {
+	    die "$0: ERROR[$linenum]: allocating from unknown arena.\n";
+	}
+	push @{$ARENA{$size}}, $id;
+	$INARENA{$id} = 1;
+	$cmd = "a";
+    }
+    if ($cmd eq "z" or $cmd eq "d") {
+	if (!exists($ARENA{$id})) {
+	    die "$0: ERROR[$linenum]: resetting unknown arena.\n";
+	}
+	@ids = @{$ARENA{$id}};
+	if ($cmd eq "z") {
+	    $ARENA{$id} = [];
+	}
+	else {
+	    delete $ARENA{$id};
+	}
+	$arena_free = 1;
+	$cmd = "f";
+    }
+
+    foreach $id (@ids) {
     if ($cmd eq "a" and $HASH{$id} eq "a") {
 	die "$0: ERROR[$linenum]: allocate with no intervening free.\n";
     }
@@ -107,19 +165,25 @@ while ($line = <STDIN>) {
 	next;
     }
     
+    if ($cmd eq "f" and $INARENA{$id} and !$arena_free) {
+	die "$0: ERROR[$linenum]: freeing an arena object.\n";
+    }
+
     if ($cmd eq "f") {
 	delete $HASH{$id};
+	delete $INARENA{$id};
     }
     else {
 	$HASH{$id} = $cmd;
     }
+    }
 }
 
 # 
 # If called with -s argument , print a brief balance summary and exit
 #
 if ($summary) {
-    if (!%HASH) {
+    if (!%HASH and !%ARENA) {
 	print "Balanced trace.\n";
     } 
     else {
@@ -131,7 +195,12 @@ if ($summary) {
 #
 # Output a balanced version of the trace
 #
-$new_ops = keys %HASH;
+foreach $key (keys %ARENA) {
+    foreach $id (@{$ARENA{$key}}) {
+	delete $HASH{$id};
+    }
+}
+$new_ops = (keys %HASH) + (keys %ARENA);
 $new_num_ops = $old_num_ops + $new_ops;
 
 print "$heap_size\n";
@@ -144,7 +213,11 @@ foreach $item (@lines) {
     print "$item\n";
 }
 
-# print a set of free requests that will balance the trace
+# print a set of free requests that will balance the trace, destroying
+# any arenas left open first
+foreach $key (sort keys %ARENA) {
+    print "d $key\n";
+}
 foreach $key (sort keys %HASH) {
     if ($HASH{$key} ne "a" and $HASH{$key} ne "r") {
 	die "$0: ERROR: Invalid free request in residue.\n";
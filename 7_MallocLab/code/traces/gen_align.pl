@@ -0,0 +1,71 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = $argv[0];
+$out_filename = "align.rep" unless $out_filename;
+$num_blocks = $argv[1];
+$num_blocks = 2400 unless $num_blocks;
+$max_blk_size = $argv[2];
+$max_blk_size = 4096 unless $max_blk_size;
+@alignments = (16, 32, 64, 256, 4096);
+
+srand(213);
+
+# Create trace
+# Make a series of malloc()s, calloc()s and memalign()s
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $size = 1 + int(rand $max_blk_size);
+    $op = {};
+    $op->{type} = ("a", "c", "m")[int(rand 3)];
+    $op->{seq} = $i;
+    $op->{size} = $size;
+    $op->{align} = $alignments[int(rand @alignments)];
+    $op->{usable} = (rand() < 0.5);
+    $total_block_size += $size;
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_usable = grep { $_->{type} ne "f" && $_->{usable} } @trace;
+$num_ops = 2*$num_blocks + $num_usable;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+# Half of the blocks ask for their usable size right after allocation
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    $op = $trace[$i];
+    if ($op->{type} eq "f") {
+        print OUTFILE "f $op->{seq}\n";
+        next;
+    }
+    if ($op->{type} eq "m") {
+        print OUTFILE "m $op->{seq} $op->{align} $op->{size}\n";
+    } else {
+        print OUTFILE "$op->{type} $op->{seq} $op->{size}\n";
+    }
+    if ($op->{usable}) {
+        print OUTFILE "u $op->{seq}\n";
+    }
+}
+
+close OUTFILE;
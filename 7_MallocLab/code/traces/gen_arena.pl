@@ -0,0 +1,109 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+# Request-scoped work: a few arenas each serve one request at a time,
+# allocating a burst of small objects (now and then a big one) and
+# dropping them all with a reset when the request ends. Ordinary
+# long-lived blocks are allocated and freed in between. arena.rep uses
+# the arena requests (n, g, z, d); arena-scalar.rep makes the same
+# requests with malloc and free, so the two can be compared.
+
+$num_arenas = 4;
+$num_requests = 160;
+$max_plain = 64;
+
+srand(215);
+
+$next_id = 0;
+$total_block_size = 0;
+@trace = ();
+@plain = ();
+
+# Size of one arena object: mostly small, sometimes medium or big
+sub object_size {
+    my $r = rand();
+    return 2000 + int(rand 4000) if ($r < 0.02);
+    return 200 + int(rand 800) if ($r < 0.12);
+    return 8 + int(rand 120);
+}
+
+for ($a = 0; $a < $num_arenas; $a++) {
+    push @trace, ["n", $a];
+    $left[$a] = 16 + int(rand 241);
+    $members[$a] = [];
+}
+
+$started = $num_arenas;
+$open = $num_arenas;
+while ($open > 0) {
+    $a = int(rand $num_arenas);
+    next if ($left[$a] == 0);
+
+    # every so often a long-lived block comes or goes
+    if (rand() < 0.1) {
+        if (@plain < $max_plain and rand() < 0.6) {
+            $size = 16 + int(rand 497);
+            push @trace, ["a", $next_id, $size];
+            push @plain, $next_id++;
+            $total_block_size += $size;
+        } elsif (@plain) {
+            push @trace, ["f", splice(@plain, int(rand @plain), 1)];
+        }
+    }
+
+    $size = object_size();
+    push @trace, ["g", $next_id, $a, $size];
+    push @{$members[$a]}, $next_id++;
+    $total_block_size += $size;
+
+    # the request is done: drop all of it and start the next one
+    if (--$left[$a] == 0) {
+        push @trace, ["z", $a, @{$members[$a]}];
+        $members[$a] = [];
+        if ($started < $num_requests) {
+            $left[$a] = 16 + int(rand 241);
+            $started++;
+        } else {
+            $open--;
+        }
+    }
+}
+for ($a = 0; $a < $num_arenas; $a++) {
+    push @trace, ["d", $a];
+}
+push @trace, ["f", $_] foreach @plain;
+
+# Write the arena trace and its malloc/free twin
+sub emit {
+    my ($out_filename, $scalar) = @_;
+    my @lines = ();
+    foreach $op (@trace) {
+        my ($type, $id, @rest) = @$op;
+        if ($type eq "n" or $type eq "d") {
+            push @lines, "$type $id" if (!$scalar);
+        } elsif ($type eq "g") {
+            push @lines, $scalar ? "a $id $rest[1]" : "g $id $rest[0] $rest[1]";
+        } elsif ($type eq "z") {
+            if ($scalar) {
+                push @lines, "f $_" foreach @rest;
+            } else {
+                push @lines, "z $id";
+            }
+        } elsif ($type eq "a") {
+            push @lines, "a $id $rest[0]";
+        } else {
+            push @lines, "f $id";
+        }
+    }
+
+    open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+    print OUTFILE $total_block_size + 100, "\n";
+    print OUTFILE "$next_id\n";
+    print OUTFILE scalar(@lines), "\n";
+    print OUTFILE "1\n";
+    print OUTFILE "$_\n" foreach @lines;
+    close OUTFILE;
+}
+
+emit("arena.rep", 0);
+emit("arena-scalar.rep", 1);
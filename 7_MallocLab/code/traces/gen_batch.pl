@@ -0,0 +1,74 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+# Batches of same-sized nodes that are allocated together and freed
+# together, with some single blocks in between. batch.rep uses the
+# batch requests (b, x) and sized frees (s); batch-scalar.rep makes
+# the same requests one block at a time, so the two can be compared.
+
+$num_batches = 400;
+$max_live = 32;
+@sizes = (24, 48, 96, 200, 320, 640);
+
+srand(214);
+
+$next_id = 0;
+$total_block_size = 0;
+@live = ();
+
+# Free one live batch (or single block), chosen at random
+sub retire {
+    my $k = int(rand @live);
+    my $b = splice @live, $k, 1;
+    if ($b->{n} > 1 and rand() < 0.75) {
+        push @trace, ["x", $b->{id}, $b->{n}];
+    } else {
+        for ($i = 0; $i < $b->{n}; $i++) {
+            push @trace, ["s", $b->{id} + $i];
+        }
+    }
+}
+
+for ($r = 0; $r < $num_batches; $r++) {
+    $size = $sizes[int(rand @sizes)];
+    $n = (rand() < 0.25) ? 1 : 16 + int(rand 49);
+    push @trace, ["b", $next_id, $n, $size];
+    push @live, {id => $next_id, n => $n};
+    $next_id += $n;
+    $total_block_size += $n * $size;
+    retire() while (@live > $max_live);
+}
+retire() while (@live);
+
+# Write the batched trace and its one-block-at-a-time twin
+sub emit {
+    my ($out_filename, $scalar) = @_;
+    my @lines = ();
+    foreach $op (@trace) {
+        my ($type, $id, $n, $size) = @$op;
+        if ($type eq "b" and ($scalar or $n == 1)) {
+            push @lines, "a " . ($id + $_) . " $size" foreach (0 .. $n - 1);
+        } elsif ($type eq "x" and $scalar) {
+            push @lines, "f " . ($id + $_) foreach (0 .. $n - 1);
+        } elsif ($type eq "s" and $scalar) {
+            push @lines, "f $id";
+        } elsif ($type eq "b") {
+            push @lines, "b $id $n $size";
+        } elsif ($type eq "x") {
+            push @lines, "x $id $n";
+        } else {
+            push @lines, "s $id";
+        }
+    }
+
+    open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+    print OUTFILE $total_block_size + 100, "\n";
+    print OUTFILE "$next_id\n";
+    print OUTFILE scalar(@lines), "\n";
+    print OUTFILE "1\n";
+    print OUTFILE "$_\n" foreach @lines;
+    close OUTFILE;
+}
+
+emit("batch.rep", 0);
+emit("batch-scalar.rep", 1);